@@ -0,0 +1,100 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef ENABLE_ALLOCATION_COUNTING
+namespace
+{
+	//Nothing else is ordered by it, relaxed is enough
+	std::atomic<uint64_t> g_NrAllocations{ 0 };
+
+	void* AllocateAligned(size_t size, size_t alignment)
+	{
+		if (size == 0)
+			size = 1;
+#ifdef _WIN32
+		return _aligned_malloc(size, alignment);
+#else
+		//aligned_alloc wants a multiple of the alignment
+		return std::aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+#endif
+	}
+
+	void FreeAligned(void* pData)
+	{
+#ifdef _WIN32
+		_aligned_free(pData);
+#else
+		std::free(pData);
+#endif
+	}
+}
+
+#endif
+
+namespace dae
+{
+	bool AllocationCounter::IsCounting()
+	{
+#ifdef ENABLE_ALLOCATION_COUNTING
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	uint64_t AllocationCounter::GetNrAllocations()
+	{
+#ifdef ENABLE_ALLOCATION_COUNTING
+		return g_NrAllocations.load(std::memory_order_relaxed);
+#else
+		return 0;
+#endif
+	}
+}
+
+#ifdef ENABLE_ALLOCATION_COUNTING
+
+//The array and nothrow versions all end up in these by default
+void* operator new(size_t size)
+{
+	g_NrAllocations.fetch_add(1, std::memory_order_relaxed);
+
+	void* pData{ std::malloc(size == 0 ? 1 : size) };
+	if (!pData)
+		throw std::bad_alloc{};
+	return pData;
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	g_NrAllocations.fetch_add(1, std::memory_order_relaxed);
+
+	void* pData{ AllocateAligned(size, size_t(alignment)) };
+	if (!pData)
+		throw std::bad_alloc{};
+	return pData;
+}
+
+void operator delete(void* pData) noexcept
+{
+	std::free(pData);
+}
+
+void operator delete(void* pData, size_t) noexcept
+{
+	std::free(pData);
+}
+
+void operator delete(void* pData, std::align_val_t) noexcept
+{
+	FreeAligned(pData);
+}
+
+void operator delete(void* pData, size_t, std::align_val_t) noexcept
+{
+	FreeAligned(pData);
+}
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdint>
+
+namespace dae
+{
+	//Define ENABLE_ALLOCATION_COUNTING to replace the global operator new and count how often the heap gets hit, from any thread.
+	//Other builds keep the allocator of the runtime and count nothing. Only allocations through new are seen, SDL and other C code use malloc directly
+	namespace AllocationCounter
+	{
+		bool IsCounting();
+		//Always 0 when the build doesn't count
+		uint64_t GetNrAllocations();
+	}
+}
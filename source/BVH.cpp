@@ -0,0 +1,305 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace dae
+{
+	namespace
+	{
+		BoundingBox GetEmptyBounds()
+		{
+			return { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+		}
+
+		BoundingBox Merge(const BoundingBox& first, const BoundingBox& second)
+		{
+			return { Vector3::Min(first.min, second.min), Vector3::Max(first.max, second.max) };
+		}
+
+		float GetSurfaceArea(const BoundingBox& boundingBox)
+		{
+			const Vector3 size{ boundingBox.max - boundingBox.min };
+			return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+		}
+	}
+
+	bool IntersectRay(const Ray& ray, const Vector3& invDirection, const BoundingBox& boundingBox, float& entryDistance)
+	{
+		float nearDistance{ 0.f };
+		float farDistance{ ray.maxDistance };
+
+		for (int axis{ 0 }; axis < 3; ++axis)
+		{
+			const float distance0{ (boundingBox.min[axis] - ray.origin[axis]) * invDirection[axis] };
+			const float distance1{ (boundingBox.max[axis] - ray.origin[axis]) * invDirection[axis] };
+
+			nearDistance = std::max(nearDistance, std::min(distance0, distance1));
+			farDistance = std::min(farDistance, std::max(distance0, distance1));
+		}
+
+		entryDistance = nearDistance;
+		return nearDistance <= farDistance;
+	}
+
+	void BVH::Build(const std::vector<BoundingBox>& itemBounds)
+	{
+		const int nrItems{ int(itemBounds.size()) };
+
+		m_Nodes.clear();
+		m_ItemBounds = itemBounds;
+		m_ItemIndices.resize(nrItems);
+		std::iota(m_ItemIndices.begin(), m_ItemIndices.end(), 0);
+
+		if (nrItems == 0)
+			return;
+
+		std::vector<Vector3> centroids(nrItems);
+		for (int i{ 0 }; i < nrItems; ++i)
+			centroids[i] = (itemBounds[i].min + itemBounds[i].max) * 0.5f;
+
+		//A binary tree never has more than 2n - 1 nodes, reserving keeps the references in Subdivide valid
+		m_Nodes.reserve(size_t(2) * nrItems);
+		m_Nodes.push_back({ {}, 0, nrItems });
+		UpdateLeafBounds(m_Nodes[0], itemBounds);
+
+		Subdivide(0, itemBounds, centroids, 0);
+	}
+
+	void BVH::Refit(const std::vector<BoundingBox>& itemBounds)
+	{
+		m_ItemBounds = itemBounds;
+
+		//Children are always stored after their parent, so going backwards every child is done before its parent
+		for (int nodeIndex{ int(m_Nodes.size()) - 1 }; nodeIndex >= 0; --nodeIndex)
+		{
+			Node& node{ m_Nodes[nodeIndex] };
+			if (node.count > 0)
+				UpdateLeafBounds(node, itemBounds);
+			else
+				node.boundingBox = Merge(m_Nodes[node.first].boundingBox, m_Nodes[node.first + 1].boundingBox);
+		}
+	}
+
+	void BVH::Query(const Frustum& frustum, std::vector<int>& items) const
+	{
+		if (m_Nodes.empty())
+			return;
+
+		//Once a node is completely inside, none of its children have to be tested anymore
+		struct StackEntry
+		{
+			int nodeIndex;
+			bool isInside;
+		};
+		StackEntry stack[m_MaxDepth + 1]{};
+		int stackSize{ 0 };
+		stack[stackSize++] = { 0, false };
+
+		while (stackSize > 0)
+		{
+			const StackEntry entry{ stack[--stackSize] };
+			const Node& node{ m_Nodes[entry.nodeIndex] };
+
+			bool isInside{ entry.isInside };
+			if (!isInside)
+			{
+				if (frustum.IsOutside(node.boundingBox))
+					continue;
+				isInside = frustum.Contains(node.boundingBox);
+			}
+
+			if (node.count > 0)
+			{
+				for (int i{ node.first }; i < node.first + node.count; ++i)
+					if (isInside || !frustum.IsOutside(m_ItemBounds[m_ItemIndices[i]]))
+						items.push_back(m_ItemIndices[i]);
+				continue;
+			}
+
+			stack[stackSize++] = { node.first + 1, isInside };
+			stack[stackSize++] = { node.first, isInside };
+		}
+	}
+
+	int BVH::Raycast(const Ray& ray, const std::function<bool(int item, float& distance)>& intersectItem, float& hitDistance) const
+	{
+		if (m_Nodes.empty())
+			return -1;
+
+		const Vector3 invDirection{ 1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z };
+
+		Ray clippedRay{ ray };
+		int closestItem{ -1 };
+
+		float entryDistance{};
+		if (!IntersectRay(clippedRay, invDirection, m_Nodes[0].boundingBox, entryDistance))
+			return -1;
+
+		struct StackEntry
+		{
+			int nodeIndex;
+			float entryDistance;
+		};
+		StackEntry stack[m_MaxDepth + 1]{};
+		int stackSize{ 0 };
+		stack[stackSize++] = { 0, entryDistance };
+
+		while (stackSize > 0)
+		{
+			const StackEntry entry{ stack[--stackSize] };
+
+			//Something closer was hit after this node got pushed
+			if (entry.entryDistance > clippedRay.maxDistance)
+				continue;
+
+			const Node& node{ m_Nodes[entry.nodeIndex] };
+			if (node.count > 0)
+			{
+				for (int i{ node.first }; i < node.first + node.count; ++i)
+				{
+					float distance{};
+					if (intersectItem(m_ItemIndices[i], distance) && distance < clippedRay.maxDistance)
+					{
+						clippedRay.maxDistance = distance;
+						closestItem = m_ItemIndices[i];
+					}
+				}
+				continue;
+			}
+
+			float firstDistance{}, secondDistance{};
+			const bool hitsFirst{ IntersectRay(clippedRay, invDirection, m_Nodes[node.first].boundingBox, firstDistance) };
+			const bool hitsSecond{ IntersectRay(clippedRay, invDirection, m_Nodes[node.first + 1].boundingBox, secondDistance) };
+
+			if (hitsFirst && hitsSecond)
+			{
+				//The closest child goes on top so it gets visited first
+				if (secondDistance < firstDistance)
+				{
+					stack[stackSize++] = { node.first, firstDistance };
+					stack[stackSize++] = { node.first + 1, secondDistance };
+				}
+				else
+				{
+					stack[stackSize++] = { node.first + 1, secondDistance };
+					stack[stackSize++] = { node.first, firstDistance };
+				}
+			}
+			else if (hitsFirst)
+				stack[stackSize++] = { node.first, firstDistance };
+			else if (hitsSecond)
+				stack[stackSize++] = { node.first + 1, secondDistance };
+		}
+
+		if (closestItem >= 0)
+			hitDistance = clippedRay.maxDistance;
+		return closestItem;
+	}
+
+	void BVH::Subdivide(int nodeIndex, const std::vector<BoundingBox>& itemBounds, const std::vector<Vector3>& centroids, int depth)
+	{
+		const Node node{ m_Nodes[nodeIndex] };
+		if (node.count <= m_MaxLeafSize || depth >= m_MaxDepth - 1)
+			return;
+
+		BoundingBox centroidBounds{ GetEmptyBounds() };
+		for (int i{ node.first }; i < node.first + node.count; ++i)
+		{
+			const Vector3& centroid{ centroids[m_ItemIndices[i]] };
+			centroidBounds = Merge(centroidBounds, { centroid, centroid });
+		}
+
+		//Binned SAH: the centroids get sorted into bins along every axis and every border between two bins is a candidate split
+		int bestAxis{ -1 };
+		int bestSplit{ 0 };
+		float bestCost{ FLT_MAX };
+
+		for (int axis{ 0 }; axis < 3; ++axis)
+		{
+			const float extent{ centroidBounds.max[axis] - centroidBounds.min[axis] };
+			if (extent <= 0.f)
+				continue;
+
+			BoundingBox binBounds[m_NrBins];
+			int binCounts[m_NrBins]{};
+			std::fill(std::begin(binBounds), std::end(binBounds), GetEmptyBounds());
+
+			const float binScale{ m_NrBins / extent };
+			for (int i{ node.first }; i < node.first + node.count; ++i)
+			{
+				const int item{ m_ItemIndices[i] };
+				const int bin{ std::min(int((centroids[item][axis] - centroidBounds.min[axis]) * binScale), m_NrBins - 1) };
+				binBounds[bin] = Merge(binBounds[bin], itemBounds[item]);
+				++binCounts[bin];
+			}
+
+			//Sweep from both sides so every split is evaluated in linear time
+			float leftAreas[m_NrBins - 1]{};
+			int leftCounts[m_NrBins - 1]{};
+			BoundingBox leftBounds{ GetEmptyBounds() };
+			int leftCount{ 0 };
+			for (int split{ 0 }; split < m_NrBins - 1; ++split)
+			{
+				leftBounds = Merge(leftBounds, binBounds[split]);
+				leftCount += binCounts[split];
+				leftAreas[split] = leftCount > 0 ? GetSurfaceArea(leftBounds) : 0.f;
+				leftCounts[split] = leftCount;
+			}
+
+			BoundingBox rightBounds{ GetEmptyBounds() };
+			int rightCount{ 0 };
+			for (int split{ m_NrBins - 2 }; split >= 0; --split)
+			{
+				rightBounds = Merge(rightBounds, binBounds[split + 1]);
+				rightCount += binCounts[split + 1];
+
+				if (leftCounts[split] == 0 || rightCount == 0)
+					continue;
+
+				const float cost{ leftCounts[split] * leftAreas[split] + rightCount * GetSurfaceArea(rightBounds) };
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = split + 1;
+				}
+			}
+		}
+
+		//Every centroid is in the same spot, there's nothing to split
+		if (bestAxis < 0)
+			return;
+
+		const float binScale{ m_NrBins / (centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis]) };
+		const auto middle{ std::partition(m_ItemIndices.begin() + node.first, m_ItemIndices.begin() + node.first + node.count,
+			[&](int item)
+			{
+				const int bin{ std::min(int((centroids[item][bestAxis] - centroidBounds.min[bestAxis]) * binScale), m_NrBins - 1) };
+				return bin < bestSplit;
+			}) };
+
+		const int leftCount{ int(middle - (m_ItemIndices.begin() + node.first)) };
+		if (leftCount == 0 || leftCount == node.count)
+			return;
+
+		const int leftChild{ int(m_Nodes.size()) };
+		m_Nodes.push_back({ {}, node.first, leftCount });
+		m_Nodes.push_back({ {}, node.first + leftCount, node.count - leftCount });
+		UpdateLeafBounds(m_Nodes[leftChild], itemBounds);
+		UpdateLeafBounds(m_Nodes[leftChild + 1], itemBounds);
+
+		m_Nodes[nodeIndex].first = leftChild;
+		m_Nodes[nodeIndex].count = 0;
+
+		Subdivide(leftChild, itemBounds, centroids, depth + 1);
+		Subdivide(leftChild + 1, itemBounds, centroids, depth + 1);
+	}
+
+	void BVH::UpdateLeafBounds(Node& node, const std::vector<BoundingBox>& itemBounds) const
+	{
+		node.boundingBox = GetEmptyBounds();
+		for (int i{ node.first }; i < node.first + node.count; ++i)
+			node.boundingBox = Merge(node.boundingBox, itemBounds[m_ItemIndices[i]]);
+	}
+}
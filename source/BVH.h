@@ -0,0 +1,63 @@
+#pragma once
+#include <cfloat>
+#include <functional>
+#include <vector>
+
+#include "Culling.h"
+
+namespace dae
+{
+	struct Ray
+	{
+		Vector3 origin{};
+		Vector3 direction{};
+		float maxDistance{ FLT_MAX };
+	};
+
+	//Slab test, returns the distance along the ray where it enters the box
+	bool IntersectRay(const Ray& ray, const Vector3& invDirection, const BoundingBox& boundingBox, float& entryDistance);
+
+	//Bounding volume hierarchy over a list of boxes, built with the surface area heuristic.
+	//Items are referred to by their index in the list that was passed to Build
+	class BVH final
+	{
+	public:
+		void Build(const std::vector<BoundingBox>& itemBounds);
+
+		//Keeps the tree as it is and only grows/shrinks the nodes, for items that moved a bit.
+		//The list has to hold the same items as the one given to Build
+		void Refit(const std::vector<BoundingBox>& itemBounds);
+
+		//Appends every item whose box isn't completely outside the frustum, in no particular order
+		void Query(const Frustum& frustum, std::vector<int>& items) const;
+
+		//Visits the items front to back along the ray, the callback does the exact test and returns the hit distance if there's a hit.
+		//Returns the closest item or -1
+		int Raycast(const Ray& ray, const std::function<bool(int item, float& distance)>& intersectItem, float& hitDistance) const;
+
+		bool IsEmpty() const { return m_Nodes.empty(); }
+		size_t GetNrItems() const { return m_ItemIndices.size(); }
+
+	private:
+		//Leaves have a count and point into m_ItemIndices, inner nodes point at their first child, the second one follows it
+		struct Node
+		{
+			BoundingBox boundingBox{};
+			int first{};
+			int count{};
+		};
+
+		static constexpr int m_MaxLeafSize{ 4 };
+		static constexpr int m_NrBins{ 12 };
+		static constexpr int m_MaxDepth{ 64 };
+
+		std::vector<Node> m_Nodes{};
+		std::vector<int> m_ItemIndices{};
+
+		//Copy of the boxes of the items so the items in a leaf can be tested one by one
+		std::vector<BoundingBox> m_ItemBounds{};
+
+		void Subdivide(int nodeIndex, const std::vector<BoundingBox>& itemBounds, const std::vector<Vector3>& centroids, int depth);
+		void UpdateLeafBounds(Node& node, const std::vector<BoundingBox>& itemBounds) const;
+	};
+}
@@ -0,0 +1,168 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+#include "AllocationCounter.h"
+#include "CameraPath.h"
+#include "Renderer.h"
+
+namespace dae
+{
+	Benchmark::Benchmark(Renderer* pRenderer, const CameraPath& cameraPath) :
+		m_pRenderer{ pRenderer },
+		m_CameraPath{ cameraPath }
+	{
+	}
+
+	void Benchmark::Run(int nrFrames, int nrWarmupFrames)
+	{
+		m_FrameTimes.clear();
+		m_FrameTimes.reserve(nrFrames);
+		m_StageTimings.clear();
+		m_StageTimings.reserve(nrFrames);
+		m_ResolutionScales.clear();
+		m_ResolutionScales.reserve(nrFrames);
+		m_TotalStatistics = {};
+		m_NrHeapAllocations = 0;
+
+		//Whoever renders after the benchmark gets the renderer back the way it was
+		const bool wasMeasuringStageTimings{ m_pRenderer->IsMeasuringStageTimings() };
+		const bool wasSkippingUnchangedFrames{ m_pRenderer->IsSkippingUnchangedFrames() };
+
+		m_pRenderer->SetMeasureStageTimings(true);
+		//Warmup replays the same camera over and over, those frames have to be drawn for real
+		m_pRenderer->SetSkipUnchangedFrames(false);
+
+		//With pipelining a Render draws the frame of the Render before it, its counters and stage timings are recorded one frame late
+		const int nrLateFrames{ m_pRenderer->IsFramePipelining() ? 1 : 0 };
+
+		//Warmup frames replay the start of the path so caches and allocations are settled when measuring starts
+		for (int frame{ -nrWarmupFrames }; frame < nrFrames; ++frame)
+		{
+			const int pathFrame{ std::max(frame, 0) };
+			const float time{ m_CameraPath.GetDuration() * pathFrame / std::max(nrFrames - 1, 1) };
+
+			Vector3 origin{}, forward{};
+			m_CameraPath.Sample(time, origin, forward);
+
+			const uint64_t nrAllocationsBefore{ AllocationCounter::GetNrAllocations() };
+			const auto frameStart{ std::chrono::steady_clock::now() };
+
+			m_pRenderer->SetCameraTransform(origin, forward);
+			m_pRenderer->Render();
+
+			const auto frameEnd{ std::chrono::steady_clock::now() };
+
+			if (frame - nrLateFrames >= 0)
+				RecordDrawnFrame();
+
+			if (frame < 0) continue;
+
+			//Once warmed up only a frame that needs more transient memory than any before it should touch the heap
+			m_NrHeapAllocations += AllocationCounter::GetNrAllocations() - nrAllocationsBefore;
+
+			m_FrameTimes.push_back(std::chrono::duration<float, std::milli>(frameEnd - frameStart).count());
+			m_ResolutionScales.push_back(m_pRenderer->GetResolutionScale());
+		}
+
+		//A pipelined renderer still holds the last frame, nothing should be left over for whoever renders next
+		m_pRenderer->Flush();
+		if (nrLateFrames > 0 && nrFrames > 0)
+			RecordDrawnFrame();
+		m_pRenderer->SetMeasureStageTimings(wasMeasuringStageTimings);
+		m_pRenderer->SetSkipUnchangedFrames(wasSkippingUnchangedFrames);
+	}
+
+	void Benchmark::RecordDrawnFrame()
+	{
+		m_StageTimings.push_back(m_pRenderer->GetStageTimings());
+		m_TotalStatistics += m_pRenderer->GetStatistics();
+	}
+
+	void Benchmark::WriteJson(std::ostream& out) const
+	{
+		out << "{\n";
+		out << "  \"frames\": " << m_FrameTimes.size() << ",\n";
+		//Which antialiasing was on, timings of runs with and without it can't be compared
+		out << "  \"msaa\": " << (m_pRenderer->IsMultisampling() ? "true" : "false") << ",\n";
+		out << "  \"edgeAntialiasing\": " << (m_pRenderer->IsEdgeAntialiasing() ? "true" : "false") << ",\n";
+		//Null when the build doesn't count them, 0 would claim there were none
+		out << "  \"heapAllocationsPerFrame\": ";
+		if (AllocationCounter::IsCounting())
+			out << (m_FrameTimes.empty() ? 0.f : float(m_NrHeapAllocations) / m_FrameTimes.size()) << ",\n";
+		else
+			out << "null,\n";
+		out << "  \"frameTimeMs\": ";
+		WriteSummary(out, Summarize(m_FrameTimes));
+		out << ",\n";
+		out << "  \"resolutionScale\": ";
+		WriteSummary(out, Summarize(m_ResolutionScales));
+		out << ",\n";
+
+		out << "  \"stagesMs\": {\n";
+		for (int stage{ 0 }; stage < int(RenderStage::count); ++stage)
+		{
+			std::vector<float> stageTimes{};
+			stageTimes.reserve(m_StageTimings.size());
+			for (const StageTimings& timings : m_StageTimings)
+				stageTimes.push_back(timings.milliseconds[stage]);
+
+			out << "    \"" << GetRenderStageName(RenderStage(stage)) << "\": ";
+			WriteSummary(out, Summarize(stageTimes));
+			out << (stage + 1 < int(RenderStage::count) ? ",\n" : "\n");
+		}
+		out << "  },\n";
+
+		//Counters are averaged per frame
+		const uint64_t nrFrames{ std::max(m_FrameTimes.size(), size_t(1)) };
+		out << "  \"statisticsPerFrame\": {\n";
+		out << "    \"meshesCulled\": " << m_TotalStatistics.meshesCulled / nrFrames << ",\n";
+		out << "    \"occlusionCulled\": " << m_TotalStatistics.occlusionCulled / nrFrames << ",\n";
+		out << "    \"meshletsCulled\": " << m_TotalStatistics.meshletsCulled / nrFrames << ",\n";
+		out << "    \"verticesTransformed\": " << m_TotalStatistics.verticesTransformed / nrFrames << ",\n";
+		out << "    \"trianglesSubmitted\": " << m_TotalStatistics.trianglesSubmitted / nrFrames << ",\n";
+		out << "    \"degenerateCulled\": " << m_TotalStatistics.degenerateCulled / nrFrames << ",\n";
+		out << "    \"backFaceCulled\": " << m_TotalStatistics.backFaceCulled / nrFrames << ",\n";
+		out << "    \"frustumCulled\": " << m_TotalStatistics.frustumCulled / nrFrames << ",\n";
+		out << "    \"pixelsTested\": " << m_TotalStatistics.pixelsTested / nrFrames << ",\n";
+		out << "    \"pixelsDepthPassed\": " << m_TotalStatistics.pixelsDepthPassed / nrFrames << ",\n";
+		out << "    \"pixelsShaded\": " << m_TotalStatistics.pixelsShaded / nrFrames << "\n";
+		out << "  }\n";
+		out << "}\n";
+	}
+
+	Benchmark::Summary Benchmark::Summarize(std::vector<float> values)
+	{
+		if (values.empty())
+			return {};
+
+		std::sort(values.begin(), values.end());
+
+		//Nearest rank percentiles
+		auto percentile = [&values](float fraction)
+		{
+			const size_t rank{ static_cast<size_t>(std::ceil(fraction * values.size())) };
+			return values[std::clamp(rank, size_t(1), values.size()) - 1];
+		};
+
+		Summary summary{};
+		summary.min = values.front();
+		summary.median = percentile(0.5f);
+		summary.p99 = percentile(0.99f);
+		summary.mean = std::accumulate(values.begin(), values.end(), 0.f) / values.size();
+		summary.max = values.back();
+		return summary;
+	}
+
+	void Benchmark::WriteSummary(std::ostream& out, const Summary& summary)
+	{
+		out << "{ \"min\": " << summary.min
+			<< ", \"median\": " << summary.median
+			<< ", \"p99\": " << summary.p99
+			<< ", \"mean\": " << summary.mean
+			<< ", \"max\": " << summary.max << " }";
+	}
+}
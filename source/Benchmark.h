@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "RenderStats.h"
+
+namespace dae
+{
+	class Renderer;
+	class CameraPath;
+
+	//Replays a camera path and collects frame and stage timings, the same path always renders the same frames
+	class Benchmark final
+	{
+	public:
+		Benchmark(Renderer* pRenderer, const CameraPath& cameraPath);
+
+		void Run(int nrFrames, int nrWarmupFrames);
+		void WriteJson(std::ostream& out) const;
+
+		//Heap allocations made by the measured frames, once warmed up there shouldn't be any
+		uint64_t GetNrHeapAllocations() const { return m_NrHeapAllocations; }
+
+		//Shared with the other benchmarks so they all report the same way
+		struct Summary
+		{
+			float min{};
+			float median{};
+			float p99{};
+			float mean{};
+			float max{};
+		};
+		static Summary Summarize(std::vector<float> values);
+		static void WriteSummary(std::ostream& out, const Summary& summary);
+
+	private:
+		//Counters and stage timings of the frame the renderer presented last
+		void RecordDrawnFrame();
+
+		Renderer* m_pRenderer{};
+		const CameraPath& m_CameraPath;
+
+		std::vector<float> m_FrameTimes{};
+		std::vector<StageTimings> m_StageTimings{};
+		//Render resolution over the output resolution, only changes with a frame time budget
+		std::vector<float> m_ResolutionScales{};
+		PipelineStatistics m_TotalStatistics{};
+		//Heap allocations made by the measured frames, from any thread
+		uint64_t m_NrHeapAllocations{};
+	};
+}
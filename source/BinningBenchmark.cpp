@@ -0,0 +1,134 @@
+#include "BinningBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#include "Benchmark.h"
+#include "FrameArena.h"
+#include "JobSystem.h"
+#include "Renderer.h"
+#include "TileBins.h"
+
+namespace dae
+{
+	namespace
+	{
+		//Same tiles and batches as the renderer
+		constexpr int g_TileSize{ Renderer::m_TileSize };
+		constexpr int g_NrTrianglesPerBatch{ int(Renderer::m_NrTrianglesPerBinBatch) };
+
+		//Triangles are numbered as if every draw call had this many, only matters for the order check
+		constexpr int g_NrTrianglesPerDraw{ 256 };
+	}
+
+	BinningBenchmark::BinningBenchmark(JobSystem* pJobSystem, int width, int height, int nrTriangles) :
+		m_pJobSystem{ pJobSystem },
+		m_NrTilesX{ (width + g_TileSize - 1) / g_TileSize },
+		m_NrTilesY{ (height + g_TileSize - 1) / g_TileSize },
+		m_NrBatches{ (nrTriangles + g_NrTrianglesPerBatch - 1) / g_NrTrianglesPerBatch }
+	{
+		//Mostly small triangles like a detailed mesh in the distance, with a few big ones that cover a lot of tiles.
+		//Always the same seed so runs can be compared
+		std::mt19937 generator{ 1234 };
+		std::uniform_real_distribution<float> unit{ 0.f, 1.f };
+
+		m_Triangles.reserve(nrTriangles);
+		for (int i{ 0 }; i < nrTriangles; ++i)
+		{
+			const float size{ unit(generator) < 0.02f ? 64.f + 192.f * unit(generator) : 2.f + 30.f * std::pow(unit(generator), 4.f) };
+			const float x{ unit(generator) * (width - size) };
+			const float y{ unit(generator) * (height - size) };
+
+			m_Triangles.push_back({
+				int16_t(std::max(int(x), 0) / g_TileSize),
+				int16_t(std::max(int(y), 0) / g_TileSize),
+				int16_t(std::min(int(x + size), width - 1) / g_TileSize),
+				int16_t(std::min(int(y + size), height - 1) / g_TileSize) });
+		}
+	}
+
+	void BinningBenchmark::Run(int nrFrames, int nrWarmupFrames)
+	{
+		FrameArena arena{ m_pJobSystem->GetNrThreads() };
+		TileBins bins{ m_NrTilesX * m_NrTilesY, m_pJobSystem->GetNrThreads() };
+
+		m_FrameTimes.clear();
+		m_FrameTimes.reserve(nrFrames);
+
+		const int nrTriangles{ int(m_Triangles.size()) };
+
+		for (int frame{ -nrWarmupFrames }; frame < nrFrames; ++frame)
+		{
+			const auto frameStart{ std::chrono::steady_clock::now() };
+
+			arena.Reset();
+			bins.Reset(m_NrBatches, arena);
+
+			m_pJobSystem->ParallelFor(m_NrBatches, 1, [&](size_t first, size_t last)
+				{
+					const int threadIndex{ JobSystem::GetThreadIndex() };
+					for (int batchIndex{ int(first) }; batchIndex < int(last); ++batchIndex)
+					{
+						const int lastTriangle{ std::min((batchIndex + 1) * g_NrTrianglesPerBatch, nrTriangles) };
+						for (int triangleIndex{ batchIndex * g_NrTrianglesPerBatch }; triangleIndex < lastTriangle; ++triangleIndex)
+						{
+							const TileRect& rect{ m_Triangles[triangleIndex] };
+							const BinnedTriangle triangle{ uint32_t(triangleIndex / g_NrTrianglesPerDraw), uint32_t(triangleIndex % g_NrTrianglesPerDraw * 3) };
+
+							for (int tileY{ rect.minY }; tileY <= rect.maxY; ++tileY)
+								for (int tileX{ rect.minX }; tileX <= rect.maxX; ++tileX)
+									bins.Add(threadIndex, tileX + tileY * m_NrTilesX, triangle, arena);
+						}
+						bins.EndBatch(threadIndex, batchIndex, arena);
+					}
+				});
+			bins.Finish(arena);
+			m_pJobSystem->ParallelFor(bins.GetNrTiles(), 64, [&](size_t first, size_t last)
+				{
+					bins.Gather(int(first), int(last));
+				});
+
+			const auto frameEnd{ std::chrono::steady_clock::now() };
+
+			if (frame >= 0)
+				m_FrameTimes.push_back(std::chrono::duration<float, std::milli>(frameEnd - frameStart).count());
+		}
+
+		//Whatever thread binned what, every tile has to list its triangles in the order they were numbered
+		uint64_t nrExpected{ 0 };
+		for (const TileRect& rect : m_Triangles)
+			nrExpected += uint64_t(rect.maxX - rect.minX + 1) * (rect.maxY - rect.minY + 1);
+
+		m_NrBinnedPerFrame = 0;
+		m_IsInOrder = true;
+		for (int tileIndex{ 0 }; tileIndex < bins.GetNrTiles(); ++tileIndex)
+		{
+			int64_t previous{ -1 };
+			bins.ForEach(tileIndex, [this, &previous](const BinnedTriangle& triangle)
+				{
+					const int64_t order{ int64_t(triangle.drawIndex) * g_NrTrianglesPerDraw * 3 + triangle.firstIndex };
+					m_IsInOrder &= order > previous;
+					previous = order;
+					++m_NrBinnedPerFrame;
+				});
+		}
+		m_IsInOrder &= m_NrBinnedPerFrame == nrExpected;
+	}
+
+	void BinningBenchmark::WriteJson(std::ostream& out) const
+	{
+		out << "{\n";
+		out << "  \"frames\": " << m_FrameTimes.size() << ",\n";
+		out << "  \"threads\": " << m_pJobSystem->GetNrThreads() << ",\n";
+		out << "  \"triangles\": " << m_Triangles.size() << ",\n";
+		out << "  \"batches\": " << m_NrBatches << ",\n";
+		out << "  \"binnedPerFrame\": " << m_NrBinnedPerFrame << ",\n";
+		out << "  \"inSubmissionOrder\": " << (m_IsInOrder ? "true" : "false") << ",\n";
+		out << "  \"frameTimeMs\": ";
+		Benchmark::WriteSummary(out, Benchmark::Summarize(m_FrameTimes));
+		out << "\n";
+		out << "}\n";
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace dae
+{
+	class JobSystem;
+
+	//Bins the same made up triangles into TileBins over and over, without anything else of the renderer.
+	//Shows how binning alone scales with the number of workers, and checks every tile still has its triangles in submission order
+	class BinningBenchmark final
+	{
+	public:
+		BinningBenchmark(JobSystem* pJobSystem, int width, int height, int nrTriangles);
+
+		void Run(int nrFrames, int nrWarmupFrames);
+		void WriteJson(std::ostream& out) const;
+
+		//Every tile of the last frame had all of its triangles, in the order they were submitted
+		bool IsInOrder() const { return m_IsInOrder; }
+
+	private:
+		//Tiles a triangle touches, inclusive
+		struct TileRect
+		{
+			int16_t minX{};
+			int16_t minY{};
+			int16_t maxX{};
+			int16_t maxY{};
+		};
+
+		JobSystem* m_pJobSystem{};
+		int m_NrTilesX{};
+		int m_NrTilesY{};
+		int m_NrBatches{};
+		std::vector<TileRect> m_Triangles{};
+
+		std::vector<float> m_FrameTimes{};
+		uint64_t m_NrBinnedPerFrame{};
+		bool m_IsInOrder{};
+	};
+}
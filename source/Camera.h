@@ -1,5 +1,6 @@
 #pragma once
 #include <cassert>
+#include <cstdint>
 #include <SDL_keyboard.h>
 #include <SDL_mouse.h>
 
@@ -38,6 +39,11 @@ namespace dae
 		Matrix viewMatrix{};
 		Matrix projectionMatrix{};
 
+		//The matrices are only calculated again when something they depend on changed.
+		//Version goes up every time they are, so others can tell whether the camera moved since they last looked
+		bool areMatricesDirty{ true };
+		uint64_t version{};
+
 		void Initialize(float _fovAngle = 60.f, Vector3 _origin = {0.f,0.f,-10.f}, float _aspectRatio = 1.333f)
 		{
 			fovAngle = _fovAngle;
@@ -45,6 +51,31 @@ namespace dae
 			aspectRatio = _aspectRatio;
 
 			origin = _origin;
+			areMatricesDirty = true;
+		}
+
+		void SetTransform(const Vector3& _origin, const Vector3& _forward)
+		{
+			const Vector3 newForward{ _forward.Normalized() };
+			if (_origin.x != origin.x || _origin.y != origin.y || _origin.z != origin.z ||
+				newForward.x != forward.x || newForward.y != forward.y || newForward.z != forward.z)
+			{
+				origin = _origin;
+				forward = newForward;
+				areMatricesDirty = true;
+			}
+
+			UpdateMatrices();
+		}
+
+		void UpdateMatrices()
+		{
+			if (!areMatricesDirty) return;
+
+			CalculateViewMatrix();
+			CalculateProjectionMatrix();
+			areMatricesDirty = false;
+			++version;
 		}
 
 		void CalculateViewMatrix()
@@ -84,25 +115,29 @@ namespace dae
 			if (pKeyboardState[SDL_SCANCODE_W] || pKeyboardState[SDL_SCANCODE_UP])
 			{
 				origin += forward * movementSpeed;
+				areMatricesDirty = true;
 			}
 			else if (pKeyboardState[SDL_SCANCODE_S] || pKeyboardState[SDL_SCANCODE_DOWN])
 			{
 				origin -= forward * movementSpeed;
+				areMatricesDirty = true;
 			}
 			if (pKeyboardState[SDL_SCANCODE_D] || pKeyboardState[SDL_SCANCODE_RIGHT])
 			{
 				origin += right * movementSpeed;
+				areMatricesDirty = true;
 			}
 			else if (pKeyboardState[SDL_SCANCODE_A] || pKeyboardState[SDL_SCANCODE_LEFT])
 			{
 				origin -= right * movementSpeed;
+				areMatricesDirty = true;
 			}
 
 			//Mouse Input
 			int mouseX{}, mouseY{};
 			const uint32_t mouseState = SDL_GetRelativeMouseState(&mouseX, &mouseY);
 
-			if (mouseState & SDL_BUTTON(SDL_BUTTON_LEFT))
+			if ((mouseState & SDL_BUTTON(SDL_BUTTON_LEFT)) && mouseY != 0)
 			{
 				if (mouseState & SDL_BUTTON(SDL_BUTTON_RIGHT))
 				{
@@ -112,17 +147,18 @@ namespace dae
 				{
 					origin += forward * (-mouseY * movementSpeed * deltaTime);
 				}
+				areMatricesDirty = true;
 			}
 
-			if (mouseState & SDL_BUTTON_RMASK)
+			if ((mouseState & SDL_BUTTON_RMASK) && (mouseX != 0 || mouseY != 0))
 			{
 				forward = Matrix::CreateRotationY(mouseX * sensitivity).TransformVector(forward);
 				forward = Matrix::CreateRotationX(mouseY * sensitivity).TransformVector(forward);
+				areMatricesDirty = true;
 			}
 
-			//Update Matrices
-			CalculateViewMatrix();
-			CalculateProjectionMatrix();
+			//Update Matrices, without input they're still what they were
+			UpdateMatrices();
 		}
 	};
 }
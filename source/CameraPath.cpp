@@ -0,0 +1,92 @@
+#include "CameraPath.h"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <sstream>
+
+namespace dae
+{
+	CameraPath CameraPath::CreateOrbit(const Vector3& target, float radius, float height, float duration, int nrKeys)
+	{
+		CameraPath path{};
+
+		for (int i{ 0 }; i <= nrKeys; ++i)
+		{
+			const float progress{ float(i) / nrKeys };
+			const float angle{ progress * PI_2 };
+
+			const Vector3 origin{ target.x - sinf(angle) * radius, target.y + height, target.z - cosf(angle) * radius };
+			path.AddKey({ progress * duration, origin, (target - origin).Normalized() });
+		}
+
+		return path;
+	}
+
+	bool CameraPath::LoadFromFile(const std::string& filename)
+	{
+		std::ifstream file(filename);
+		if (!file)
+			return false;
+
+		m_Keys.clear();
+
+		std::string line;
+		while (std::getline(file, line))
+		{
+			const size_t commentStart{ line.find('#') };
+			if (commentStart != std::string::npos)
+				line.erase(commentStart);
+
+			std::istringstream lineStream{ line };
+			Key key{};
+			if (lineStream >> key.time >> key.origin.x >> key.origin.y >> key.origin.z
+				>> key.forward.x >> key.forward.y >> key.forward.z)
+			{
+				key.forward.Normalize();
+				AddKey(key);
+			}
+		}
+
+		return !m_Keys.empty();
+	}
+
+	void CameraPath::AddKey(const Key& key)
+	{
+		//Keep the keys sorted on time so sampling can do a binary search
+		const auto it = std::upper_bound(m_Keys.begin(), m_Keys.end(), key.time,
+			[](float time, const Key& other) { return time < other.time; });
+		m_Keys.insert(it, key);
+	}
+
+	void CameraPath::Sample(float time, Vector3& origin, Vector3& forward) const
+	{
+		assert(!m_Keys.empty() && "ERROR: sampling an empty camera path!");
+
+		if (time <= m_Keys.front().time)
+		{
+			origin = m_Keys.front().origin;
+			forward = m_Keys.front().forward;
+			return;
+		}
+		if (time >= m_Keys.back().time)
+		{
+			origin = m_Keys.back().origin;
+			forward = m_Keys.back().forward;
+			return;
+		}
+
+		const auto next = std::upper_bound(m_Keys.begin(), m_Keys.end(), time,
+			[](float t, const Key& key) { return t < key.time; });
+		const auto previous = next - 1;
+
+		const float factor{ (time - previous->time) / (next->time - previous->time) };
+		origin = previous->origin + (next->origin - previous->origin) * factor;
+		forward = (previous->forward + (next->forward - previous->forward) * factor).Normalized();
+	}
+
+	float CameraPath::GetDuration() const
+	{
+		return m_Keys.empty() ? 0.f : m_Keys.back().time;
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Math.h"
+
+namespace dae
+{
+	//A scripted camera flight so frames can be reproduced without any input
+	class CameraPath final
+	{
+	public:
+		struct Key
+		{
+			float time{};
+			Vector3 origin{};
+			Vector3 forward{ Vector3::UnitZ };
+		};
+
+		CameraPath() = default;
+
+		static CameraPath CreateOrbit(const Vector3& target, float radius, float height, float duration, int nrKeys = 32);
+
+		//Every line holds a key as "time originX originY originZ forwardX forwardY forwardZ", '#' starts a comment
+		bool LoadFromFile(const std::string& filename);
+		void AddKey(const Key& key);
+
+		void Sample(float time, Vector3& origin, Vector3& forward) const;
+		float GetDuration() const;
+		bool IsEmpty() const { return m_Keys.empty(); }
+
+	private:
+		std::vector<Key> m_Keys{};
+	};
+}
@@ -0,0 +1,230 @@
+#include "Culling.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	namespace
+	{
+		Vector3 GetPosition(const PositionStream& positions, uint32_t index)
+		{
+			return { positions.x[index], positions.y[index], positions.z[index] };
+		}
+
+		float GetPlaneDistance(const Vector4& plane, const Vector3& point)
+		{
+			return plane.x * point.x + plane.y * point.y + plane.z * point.z + plane.w;
+		}
+
+		void FitBounds(const std::vector<Vector3>& points, BoundingBox& boundingBox, BoundingSphere& boundingSphere)
+		{
+			if (points.empty())
+			{
+				boundingBox = {};
+				boundingSphere = {};
+				return;
+			}
+
+			boundingBox = { points[0], points[0] };
+			for (const Vector3& point : points)
+			{
+				boundingBox.min = Vector3::Min(boundingBox.min, point);
+				boundingBox.max = Vector3::Max(boundingBox.max, point);
+			}
+
+			//Centered on the box, not the tightest sphere but close enough for culling
+			boundingSphere.center = (boundingBox.min + boundingBox.max) * 0.5f;
+			float sqrRadius{ 0.f };
+			for (const Vector3& point : points)
+				sqrRadius = std::max(sqrRadius, (point - boundingSphere.center).SqrMagnitude());
+			boundingSphere.radius = std::sqrt(sqrRadius);
+		}
+
+		NormalCone BuildNormalCone(const PositionStream& positions, const uint32_t* pIndices, uint32_t nrTriangles)
+		{
+			//Normals point to the side the triangle is visible from, the opposite of the winding RenderTriangle culls
+			std::vector<Vector3> normals{};
+			normals.reserve(nrTriangles);
+
+			Vector3 axis{};
+			for (uint32_t triangle{ 0 }; triangle < nrTriangles; ++triangle)
+			{
+				const Vector3 p0{ GetPosition(positions, pIndices[3 * triangle]) };
+				const Vector3 p1{ GetPosition(positions, pIndices[3 * triangle + 1]) };
+				const Vector3 p2{ GetPosition(positions, pIndices[3 * triangle + 2]) };
+
+				const Vector3 normal{ Vector3::Cross(p1 - p0, p2 - p0) };
+				const float length{ normal.Magnitude() };
+
+				//Degenerate triangles never get drawn, they don't restrict the cone
+				if (length <= 0.f)
+					continue;
+
+				normals.push_back(normal / length);
+				axis += normals.back();
+			}
+
+			const float axisLength{ axis.Magnitude() };
+			if (normals.empty() || axisLength <= 0.f)
+				return {};
+
+			axis /= axisLength;
+
+			float minDot{ 1.f };
+			for (const Vector3& normal : normals)
+				minDot = std::min(minDot, Vector3::Dot(normal, axis));
+
+			//Once the normals spread over a hemisphere there's no direction they all face away from
+			if (minDot <= 0.f)
+				return {};
+
+			return { axis, std::sqrt(1.f - minDot * minDot), true };
+		}
+	}
+
+	Frustum Frustum::FromMatrix(const Matrix& viewProjection)
+	{
+		//Points get multiplied as row vectors, so every clip space component is a column of the matrix
+		auto column = [&viewProjection](int index)
+		{
+			return Vector4{ viewProjection[0][index], viewProjection[1][index], viewProjection[2][index], viewProjection[3][index] };
+		};
+
+		const Vector4 x{ column(0) };
+		const Vector4 y{ column(1) };
+		const Vector4 z{ column(2) };
+		const Vector4 w{ column(3) };
+
+		Frustum frustum{};
+		frustum.planes[0] = w + x;
+		frustum.planes[1] = w - x;
+		frustum.planes[2] = w + y;
+		frustum.planes[3] = w - y;
+		frustum.planes[4] = z; //Depth goes from 0 to 1
+		frustum.planes[5] = w - z;
+
+		for (Vector4& plane : frustum.planes)
+		{
+			const float length{ Vector3{ plane.x, plane.y, plane.z }.Magnitude() };
+			if (length > 0.f)
+				plane = plane * (1.f / length);
+		}
+
+		return frustum;
+	}
+
+	bool Frustum::IsOutside(const BoundingBox& boundingBox) const
+	{
+		for (const Vector4& plane : planes)
+		{
+			//The corner furthest along the plane normal, if even that one is behind the plane the whole box is
+			const Vector3 corner{
+				plane.x >= 0.f ? boundingBox.max.x : boundingBox.min.x,
+				plane.y >= 0.f ? boundingBox.max.y : boundingBox.min.y,
+				plane.z >= 0.f ? boundingBox.max.z : boundingBox.min.z };
+
+			if (GetPlaneDistance(plane, corner) < 0.f)
+				return true;
+		}
+		return false;
+	}
+
+	bool Frustum::Contains(const BoundingBox& boundingBox) const
+	{
+		for (const Vector4& plane : planes)
+		{
+			//The corner furthest against the plane normal has to be inside as well
+			const Vector3 corner{
+				plane.x >= 0.f ? boundingBox.min.x : boundingBox.max.x,
+				plane.y >= 0.f ? boundingBox.min.y : boundingBox.max.y,
+				plane.z >= 0.f ? boundingBox.min.z : boundingBox.max.z };
+
+			if (GetPlaneDistance(plane, corner) < 0.f)
+				return false;
+		}
+		return true;
+	}
+
+	bool Frustum::IsOutside(const BoundingSphere& boundingSphere) const
+	{
+		for (const Vector4& plane : planes)
+			if (GetPlaneDistance(plane, boundingSphere.center) < -boundingSphere.radius)
+				return true;
+		return false;
+	}
+
+	namespace Culling
+	{
+		void ComputeBounds(const PositionStream& positions, BoundingBox& boundingBox, BoundingSphere& boundingSphere)
+		{
+			std::vector<Vector3> points(positions.x.size());
+			for (uint32_t i{ 0 }; i < points.size(); ++i)
+				points[i] = GetPosition(positions, i);
+
+			FitBounds(points, boundingBox, boundingSphere);
+		}
+
+		BoundingBox TransformBounds(const BoundingBox& boundingBox, const Matrix& matrix)
+		{
+			const Vector3 center{ matrix.TransformPoint((boundingBox.min + boundingBox.max) * 0.5f) };
+			const Vector3 extents{ (boundingBox.max - boundingBox.min) * 0.5f };
+
+			//Every axis of the new box gets the absolute contribution of every axis of the old one
+			Vector3 newExtents{};
+			for (int column{ 0 }; column < 3; ++column)
+				for (int row{ 0 }; row < 3; ++row)
+					newExtents[column] += std::abs(matrix[row][column]) * extents[row];
+
+			return { center - newExtents, center + newExtents };
+		}
+
+		void BuildMeshlets(const PositionStream& positions, const std::vector<uint32_t>& indices, PrimitiveTopology topology,
+			std::vector<Meshlet>& meshlets, uint32_t maxTriangles)
+		{
+			meshlets.clear();
+			if (indices.empty())
+				return;
+
+			//Triangles of a strip depend on their neighbours, so the strip stays in one piece
+			const uint32_t indicesPerMeshlet{ topology == PrimitiveTopology::TriangleList ? 3 * maxTriangles : uint32_t(indices.size()) };
+
+			std::vector<Vector3> points{};
+			for (uint32_t firstIndex{ 0 }; firstIndex < indices.size(); firstIndex += indicesPerMeshlet)
+			{
+				Meshlet meshlet{};
+				meshlet.firstIndex = firstIndex;
+				meshlet.nrIndices = std::min(indicesPerMeshlet, uint32_t(indices.size()) - firstIndex);
+
+				const auto first{ indices.begin() + firstIndex };
+				const auto last{ first + meshlet.nrIndices };
+				const auto [minIndex, maxIndex] { std::minmax_element(first, last) };
+				meshlet.firstVertex = *minIndex;
+				meshlet.nrVertices = *maxIndex - *minIndex + 1;
+
+				points.clear();
+				for (auto index{ first }; index != last; ++index)
+					points.push_back(GetPosition(positions, *index));
+				FitBounds(points, meshlet.boundingBox, meshlet.boundingSphere);
+
+				if (topology == PrimitiveTopology::TriangleList)
+					meshlet.normalCone = BuildNormalCone(positions, indices.data() + firstIndex, meshlet.nrIndices / 3);
+
+				meshlets.push_back(meshlet);
+			}
+		}
+
+		bool IsBackFacing(const Meshlet& meshlet, const Vector3& cameraPosition)
+		{
+			const NormalCone& cone{ meshlet.normalCone };
+			if (!cone.isValid)
+				return false;
+
+			//Conservative cone test over the bounding sphere: every point of the meshlet is seen from behind
+			const Vector3 toCenter{ meshlet.boundingSphere.center - cameraPosition };
+			return Vector3::Dot(toCenter, cone.axis) >= cone.cutoff * toCenter.Magnitude() + meshlet.boundingSphere.radius;
+		}
+	}
+}
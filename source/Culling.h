@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Math.h"
+
+namespace dae
+{
+	struct PositionStream;
+	enum class PrimitiveTopology;
+
+	struct BoundingBox
+	{
+		Vector3 min{};
+		Vector3 max{};
+	};
+
+	struct BoundingSphere
+	{
+		Vector3 center{};
+		float radius{};
+	};
+
+	//All triangles of a meshlet face away from the camera when it looks along the axis from inside the cone,
+	//cutoff is the sine of the widest angle between the axis and a triangle normal
+	struct NormalCone
+	{
+		Vector3 axis{};
+		float cutoff{};
+		bool isValid{};
+	};
+
+	//A small run of triangles with its own bounds so parts of a mesh can be culled before the vertex stage
+	struct Meshlet
+	{
+		uint32_t firstIndex{};
+		uint32_t nrIndices{};
+
+		//Range of vertices the indices refer to
+		uint32_t firstVertex{};
+		uint32_t nrVertices{};
+
+		BoundingBox boundingBox{};
+		BoundingSphere boundingSphere{};
+		NormalCone normalCone{};
+	};
+
+	//Planes are pulled out of a (world)viewProjection matrix, so they live in whatever space the matrix starts from
+	struct Frustum
+	{
+		//left, right, bottom, top, near, far as (normal, distance) with the normal pointing inwards
+		Vector4 planes[6]{};
+
+		static Frustum FromMatrix(const Matrix& viewProjection);
+
+		bool IsOutside(const BoundingBox& boundingBox) const;
+		bool IsOutside(const BoundingSphere& boundingSphere) const;
+		bool Contains(const BoundingBox& boundingBox) const;
+	};
+
+	namespace Culling
+	{
+		void ComputeBounds(const PositionStream& positions, BoundingBox& boundingBox, BoundingSphere& boundingSphere);
+
+		//Box around the transformed box, looser than transforming the points themselves
+		BoundingBox TransformBounds(const BoundingBox& boundingBox, const Matrix& matrix);
+
+		//Splits a triangle list into runs of at most maxTriangles, strips become one meshlet without a normal cone
+		void BuildMeshlets(const PositionStream& positions, const std::vector<uint32_t>& indices, PrimitiveTopology topology,
+			std::vector<Meshlet>& meshlets, uint32_t maxTriangles = 64);
+
+		bool IsBackFacing(const Meshlet& meshlet, const Vector3& cameraPosition);
+	}
+}
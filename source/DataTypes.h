@@ -1,6 +1,9 @@
 #pragma once
+#include <cstdint>
 #include "Math.h"
 #include "vector"
+#include "Culling.h"
+#include "VertexFormat.h"
 
 namespace dae
 {
@@ -24,19 +27,71 @@ namespace dae
 		Vector3 viewDirection{};
 	};
 
+	//Vertex positions split per component so the vertex stage can load several vertices into one register
+	struct PositionStream
+	{
+		std::vector<float> x{};
+		std::vector<float> y{};
+		std::vector<float> z{};
+	};
+
+	//Output of the vertex stage: x and y in screen space (pixels), z divided by w, and 1/w for perspective correct interpolation.
+	//One entry per vertex of the mesh, the streams live in a frame arena, see VertexKernels::AllocateTransformedPositions
+	struct TransformedPositions
+	{
+		float* x{};
+		float* y{};
+		float* z{};
+		float* invW{};
+		uint8_t* isOutsideFrustum{};
+
+		//Decoded texture coordinates, already multiplied by 1/w
+		float* u{};
+		float* v{};
+
+		//Only there in the lit mode, see VertexKernels::AllocateLitAttributes. World space and not multiplied by 1/w,
+		//the rasterizer interpolates them with perspective correct weights instead
+		float* worldX{};
+		float* worldY{};
+		float* worldZ{};
+		float* normalX{};
+		float* normalY{};
+		float* normalZ{};
+		float* tangentX{};
+		float* tangentY{};
+		float* tangentZ{};
+	};
+
 	enum class PrimitiveTopology
 	{
 		TriangleList,
 		TriangleStrip
 	};
 
+	//Simplified version of a mesh, a mesh of its own in the same scene
+	struct MeshLod
+	{
+		int meshIndex{};
+		//How far the simplified surface may be from the full one, in object space
+		float error{};
+	};
+
 	struct Mesh
 	{
+		//Only filled while loading, once the attributes are packed the full vertices are released
 		std::vector<Vertex> vertices{};
 		std::vector<uint32_t> indices{};
 		PrimitiveTopology primitiveTopology{ PrimitiveTopology::TriangleStrip };
 
-		std::vector<Vertex_Out> vertices_out{};
-		Matrix worldMatrix{};
+		PositionStream positions{};
+		PackedAttributes attributes{};
+
+		//Object space bounds, computed once at load
+		BoundingBox boundingBox{};
+		BoundingSphere boundingSphere{};
+		std::vector<Meshlet> meshlets{};
+
+		//Simplified versions from detailed to coarse, empty for the simplified meshes themselves
+		std::vector<MeshLod> lods{};
 	};
 }
\ No newline at end of file
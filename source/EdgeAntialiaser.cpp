@@ -0,0 +1,429 @@
+#include "EdgeAntialiaser.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <immintrin.h>
+
+#include "JobSystem.h"
+
+namespace dae
+{
+	namespace
+	{
+		//A pixel is on an edge when the contrast with its neighbours is at least an eighth of the brightest one,
+		//dark parts of the image would be full of edges otherwise so there's a minimum of about a twelfth too
+		constexpr int g_ContrastShift{ 3 };
+		constexpr int g_MinContrast{ 21 };
+
+		//How far along an edge its ends are looked for, anything longer is blended as if it ended right there
+		constexpr int g_SearchDistance{ 16 };
+
+		//How much of the neighbour a pixel that stands out on its own can get at most
+		constexpr float g_SubpixelBlend{ 0.75f };
+
+	}
+
+	EdgeAntialiaser::EdgeAntialiaser(JobSystem* pJobSystem) :
+		m_pJobSystem{ pJobSystem }
+	{
+	}
+
+	void EdgeAntialiaser::Apply(const uint32_t* pSource, uint32_t* pDestination, int width, int height, int greenShift)
+	{
+		m_Width = width;
+		m_Height = height;
+		m_Luma.resize(size_t(width) * height);
+
+		//Every row looks at the luma of the rows around it, so all of it has to be there before filtering starts
+		m_pJobSystem->ParallelFor(height, 16, [this, pSource, greenShift](size_t first, size_t last)
+			{
+				for (size_t y{ first }; y < last; ++y)
+					ComputeLuma(pSource, int(y), greenShift);
+			});
+
+		m_pJobSystem->ParallelFor(height, 16, [this, pSource, pDestination](size_t first, size_t last)
+			{
+				for (size_t y{ first }; y < last; ++y)
+					FilterRow(pSource, pDestination, int(y));
+			});
+	}
+
+	void EdgeAntialiaser::ComputeLuma(const uint32_t* pSource, int y, int greenShift)
+	{
+		const uint32_t* pRow{ pSource + size_t(y) * m_Width };
+		uint8_t* pLuma{ m_Luma.data() + size_t(y) * m_Width };
+
+		int x{ 0 };
+
+#ifdef __AVX__
+		//16 pixels at a time, green is shifted to the bottom byte of every pixel and the 4 registers are packed down to bytes
+		const __m128i shift{ _mm_cvtsi32_si128(greenShift) };
+		const __m128i byteMask{ _mm_set1_epi32(0xFF) };
+		for (; x + 16 <= m_Width; x += 16)
+		{
+			auto loadGreen = [&](int offset)
+			{
+				const __m128i pixels{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + x + offset)) };
+				return _mm_and_si128(_mm_srl_epi32(pixels, shift), byteMask);
+			};
+			const __m128i low{ _mm_packus_epi32(loadGreen(0), loadGreen(4)) };
+			const __m128i high{ _mm_packus_epi32(loadGreen(8), loadGreen(12)) };
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pLuma + x), _mm_packus_epi16(low, high));
+		}
+#endif
+
+		for (; x < m_Width; ++x)
+			pLuma[x] = uint8_t(pRow[x] >> greenShift);
+	}
+
+	void EdgeAntialiaser::FilterRow(const uint32_t* pSource, uint32_t* pDestination, int y) const
+	{
+		const uint32_t* pSourceRow{ pSource + size_t(y) * m_Width };
+		uint32_t* pDestinationRow{ pDestination + size_t(y) * m_Width };
+
+		auto filter = [&](int x)
+		{
+			pDestinationRow[x] = IsEdge(x, y) ? FilterPixel(pSource, x, y) : pSourceRow[x];
+		};
+
+		int x{ 0 };
+
+#ifdef __AVX__
+		//Away from the border all 4 neighbours of 16 pixels can be loaded at once and checked with byte min and max.
+		//Most pixels aren't on an edge, those are only copied
+		if (y > 0 && y < m_Height - 1)
+		{
+			const uint8_t* pLuma{ m_Luma.data() + size_t(y) * m_Width };
+			const __m128i contrastMask{ _mm_set1_epi8(char(0xFF >> g_ContrastShift)) };
+			const __m128i minContrast{ _mm_set1_epi8(char(g_MinContrast)) };
+
+			filter(x++);
+			for (; x + 16 < m_Width; x += 16)
+			{
+				auto loadLuma = [&](int offset)
+				{
+					return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pLuma + x + offset));
+				};
+				const __m128i center{ loadLuma(0) };
+				const __m128i north{ loadLuma(-m_Width) };
+				const __m128i south{ loadLuma(m_Width) };
+				const __m128i west{ loadLuma(-1) };
+				const __m128i east{ loadLuma(1) };
+
+				const __m128i maxLuma{ _mm_max_epu8(_mm_max_epu8(center, north), _mm_max_epu8(_mm_max_epu8(south, west), east)) };
+				const __m128i minLuma{ _mm_min_epu8(_mm_min_epu8(center, north), _mm_min_epu8(_mm_min_epu8(south, west), east)) };
+				const __m128i contrast{ _mm_sub_epi8(maxLuma, minLuma) };
+
+				//There's no byte shift, shifting 16 bits and masking off what came in from the next byte is the same
+				const __m128i threshold{ _mm_max_epu8(minContrast, _mm_and_si128(_mm_srli_epi16(maxLuma, g_ContrastShift), contrastMask)) };
+				const __m128i isEdge{ _mm_cmpeq_epi8(_mm_max_epu8(contrast, threshold), contrast) };
+				int edgeMask{ _mm_movemask_epi8(isEdge) };
+
+				//Far enough from the left and the right, the ends of all 16 edges are searched for at once
+				if (edgeMask && x >= g_SearchDistance && x + 16 + g_SearchDistance <= m_Width)
+				{
+					FilterEdges(pSource, pDestinationRow, x, y, isEdge);
+					continue;
+				}
+
+				for (int offset{ 0 }; offset < 16; offset += 4)
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(pDestinationRow + x + offset),
+						_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSourceRow + x + offset)));
+
+				while (edgeMask)
+				{
+					const int edgeX{ x + std::countr_zero(unsigned(edgeMask)) };
+					pDestinationRow[edgeX] = FilterPixel(pSource, edgeX, y);
+					edgeMask &= edgeMask - 1;
+				}
+			}
+		}
+#endif
+
+		for (; x < m_Width; ++x)
+			filter(x);
+	}
+
+	int EdgeAntialiaser::GetLuma(int x, int y) const
+	{
+		x = std::clamp(x, 0, m_Width - 1);
+		y = std::clamp(y, 0, m_Height - 1);
+		return m_Luma[x + size_t(y) * m_Width];
+	}
+
+	bool EdgeAntialiaser::IsEdge(int x, int y) const
+	{
+		//Same test as the SIMD version in FilterRow
+		const int center{ GetLuma(x, y) };
+		const int north{ GetLuma(x, y - 1) };
+		const int south{ GetLuma(x, y + 1) };
+		const int west{ GetLuma(x - 1, y) };
+		const int east{ GetLuma(x + 1, y) };
+
+		const int maxLuma{ std::max({ center, north, south, west, east }) };
+		const int minLuma{ std::min({ center, north, south, west, east }) };
+		return maxLuma - minLuma >= std::max(g_MinContrast, maxLuma >> g_ContrastShift);
+	}
+
+	uint32_t EdgeAntialiaser::FilterPixel(const uint32_t* pSource, int x, int y) const
+	{
+		//Only pixels on the border need their neighbours clamped
+		const uint8_t* pCenter{ m_Luma.data() + x + size_t(y) * m_Width };
+		const bool isInside{ x > 0 && y > 0 && x < m_Width - 1 && y < m_Height - 1 };
+		auto getNeighbour = [&](int offsetX, int offsetY)
+		{
+			return isInside ? int(pCenter[offsetX + offsetY * m_Width]) : GetLuma(x + offsetX, y + offsetY);
+		};
+
+		const int center{ *pCenter };
+		const int north{ getNeighbour(0, -1) };
+		const int south{ getNeighbour(0, 1) };
+		const int west{ getNeighbour(-1, 0) };
+		const int east{ getNeighbour(1, 0) };
+		const int northWest{ getNeighbour(-1, -1) };
+		const int northEast{ getNeighbour(1, -1) };
+		const int southWest{ getNeighbour(-1, 1) };
+		const int southEast{ getNeighbour(1, 1) };
+
+		const int contrast{ std::max({ center, north, south, west, east }) - std::min({ center, north, south, west, east }) };
+
+		//An edge is horizontal when the brightness changes more from row to row than from column to column
+		const int horizontal{ std::abs(northWest + southWest - 2 * west) + 2 * std::abs(north + south - 2 * center) + std::abs(northEast + southEast - 2 * east) };
+		const int vertical{ std::abs(northWest + northEast - 2 * north) + 2 * std::abs(west + east - 2 * center) + std::abs(southWest + southEast - 2 * south) };
+		const bool isHorizontal{ horizontal >= vertical };
+
+		//The other side of the edge is the neighbour that differs the most
+		const int luma1{ isHorizontal ? north : west };
+		const int luma2{ isHorizontal ? south : east };
+		const int gradient1{ std::abs(luma1 - center) };
+		const int gradient2{ std::abs(luma2 - center) };
+		const int acrossSign{ gradient1 >= gradient2 ? -1 : 1 };
+		const int acrossX{ std::clamp(x + (isHorizontal ? 0 : acrossSign), 0, m_Width - 1) };
+		const int acrossY{ std::clamp(y + (isHorizontal ? acrossSign : 0), 0, m_Height - 1) };
+
+		//Rounded the same way as _mm_avg_epu8
+		const int edgeLuma{ ((acrossSign < 0 ? luma1 : luma2) + center + 1) >> 1 };
+		const int endThreshold{ std::max(std::max(gradient1, gradient2) >> 2, 1) };
+
+		//The edge runs between two lines of pixels, two rows for a horizontal edge and two columns for a vertical one
+		const uint8_t* pLine{ isHorizontal ? m_Luma.data() + size_t(y) * m_Width : m_Luma.data() + x };
+		const uint8_t* pAcrossLine{ isHorizontal ? m_Luma.data() + size_t(acrossY) * m_Width : m_Luma.data() + acrossX };
+		const int stride{ isHorizontal ? 1 : m_Width };
+		const int position{ isHorizontal ? x : y };
+		const int lineLength{ isHorizontal ? m_Width : m_Height };
+
+		auto getEdgeLuma = [&](int linePosition)
+		{
+			return (pLine[linePosition * stride] + pAcrossLine[linePosition * stride] + 1) >> 1;
+		};
+
+		//Walks along the edge until the average of both of its sides changes too much, that's where it ends.
+		//The lines go on as their last pixel past the border
+		auto findEnd = [&](int direction, bool& isEndDarker)
+		{
+			auto getEndPosition = [&](int distance) { return std::clamp(position + distance * direction, 0, lineLength - 1); };
+			int distance{ 1 };
+			for (; distance < g_SearchDistance; ++distance)
+				if (std::abs(getEdgeLuma(getEndPosition(distance)) - edgeLuma) >= endThreshold)
+					break;
+			isEndDarker = getEdgeLuma(getEndPosition(distance)) < edgeLuma;
+			return distance;
+		};
+
+		bool isNegativeEndDarker{}, isPositiveEndDarker{};
+		const int negativeDistance{ findEnd(-1, isNegativeEndDarker) };
+		const int positiveDistance{ findEnd(1, isPositiveEndDarker) };
+
+		//Only the closest end counts, and only when the edge steps towards the side this pixel is on.
+		//Close to that end the pixel gets half of its neighbour, in the middle of the edge nothing
+		const bool isEndDarker{ negativeDistance < positiveDistance ? isNegativeEndDarker : isPositiveEndDarker };
+		float blend{ 0.f };
+		if (isEndDarker != (center < edgeLuma))
+			blend = 0.5f - float(std::min(negativeDistance, positiveDistance)) / float(negativeDistance + positiveDistance);
+
+		//A pixel that stands out from all of its neighbours is a detail smaller than a pixel, those get blended on contrast alone
+		const float average{ (2 * (north + south + west + east) + northWest + northEast + southWest + southEast) / 12.f };
+		const float subpixel{ std::clamp(std::abs(average - center) / float(contrast), 0.f, 1.f) };
+		const float smoothSubpixel{ (3.f - 2.f * subpixel) * subpixel * subpixel };
+		blend = std::max(blend, smoothSubpixel * smoothSubpixel * g_SubpixelBlend);
+
+		const int weight{ int(blend * 256.f + 0.5f) };
+		const uint32_t centerColor{ pSource[x + size_t(y) * m_Width] };
+		const uint32_t otherColor{ pSource[acrossX + size_t(acrossY) * m_Width] };
+
+		uint32_t result{ 0 };
+		for (int shift{ 0 }; shift < 32; shift += 8)
+		{
+			const int centerChannel{ int(centerColor >> shift & 0xFF) };
+			const int otherChannel{ int(otherColor >> shift & 0xFF) };
+			result |= uint32_t((centerChannel * (256 - weight) + otherChannel * weight + 128) >> 8) << shift;
+		}
+		return result;
+	}
+
+#ifdef __AVX__
+	void EdgeAntialiaser::FilterEdges(const uint32_t* pSource, uint32_t* pDestinationRow, int x, int y, __m128i isEdge) const
+	{
+		//Same steps as FilterPixel, one byte per pixel. The lines along 16 neighbouring edges start in the same row or column,
+		//so every step along them loads 16 neighbouring lumas for horizontal and vertical edges alike
+		const uint8_t* pLuma{ m_Luma.data() + size_t(y) * m_Width + x };
+		auto loadLuma = [&](int offsetX, int offsetY)
+		{
+			return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pLuma + offsetX + offsetY * m_Width));
+		};
+		auto getDifference = [](__m128i a, __m128i b) { return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a)); };
+		auto isGreaterOrEqual = [](__m128i a, __m128i b) { return _mm_cmpeq_epi8(_mm_max_epu8(a, b), a); };
+		const __m128i allSet{ _mm_set1_epi8(-1) };
+
+		const __m128i center{ loadLuma(0, 0) };
+		const __m128i north{ loadLuma(0, -1) };
+		const __m128i south{ loadLuma(0, 1) };
+		const __m128i west{ loadLuma(-1, 0) };
+		const __m128i east{ loadLuma(1, 0) };
+		const __m128i northWest{ loadLuma(-1, -1) };
+		const __m128i northEast{ loadLuma(1, -1) };
+		const __m128i southWest{ loadLuma(-1, 1) };
+		const __m128i southEast{ loadLuma(1, 1) };
+
+		const __m128i maxLuma{ _mm_max_epu8(_mm_max_epu8(center, north), _mm_max_epu8(_mm_max_epu8(south, west), east)) };
+		const __m128i minLuma{ _mm_min_epu8(_mm_min_epu8(center, north), _mm_min_epu8(_mm_min_epu8(south, west), east)) };
+		const __m128i contrast{ _mm_sub_epi8(maxLuma, minLuma) };
+
+		//The direction of the edge needs more than a byte, it's worked out for 8 pixels at a time
+		auto isVerticalHalf = [&](bool isHigh)
+		{
+			const __m128i zero{ _mm_setzero_si128() };
+			auto get = [&](__m128i luma) { return isHigh ? _mm_unpackhi_epi8(luma, zero) : _mm_unpacklo_epi8(luma, zero); };
+			auto getCurvature = [](__m128i a, __m128i b, __m128i middle) { return _mm_abs_epi16(_mm_sub_epi16(_mm_add_epi16(a, b), _mm_add_epi16(middle, middle))); };
+
+			const __m128i centerCurvature{ getCurvature(get(north), get(south), get(center)) };
+			const __m128i horizontal{ _mm_add_epi16(_mm_add_epi16(getCurvature(get(northWest), get(southWest), get(west)), getCurvature(get(northEast), get(southEast), get(east))),
+				_mm_add_epi16(centerCurvature, centerCurvature)) };
+			const __m128i middleCurvature{ getCurvature(get(west), get(east), get(center)) };
+			const __m128i vertical{ _mm_add_epi16(_mm_add_epi16(getCurvature(get(northWest), get(northEast), get(north)), getCurvature(get(southWest), get(southEast), get(south))),
+				_mm_add_epi16(middleCurvature, middleCurvature)) };
+			return _mm_cmpgt_epi16(vertical, horizontal);
+		};
+		const __m128i isVertical{ _mm_packs_epi16(isVerticalHalf(false), isVerticalHalf(true)) };
+
+		const __m128i luma1{ _mm_blendv_epi8(north, west, isVertical) };
+		const __m128i luma2{ _mm_blendv_epi8(south, east, isVertical) };
+		const __m128i gradient1{ getDifference(luma1, center) };
+		const __m128i gradient2{ getDifference(luma2, center) };
+		const __m128i isAcrossNegative{ isGreaterOrEqual(gradient1, gradient2) };
+
+		const __m128i edgeLuma{ _mm_avg_epu8(_mm_blendv_epi8(luma2, luma1, isAcrossNegative), center) };
+		const __m128i endThreshold{ _mm_max_epu8(_mm_set1_epi8(1),
+			_mm_and_si128(_mm_srli_epi16(_mm_max_epu8(gradient1, gradient2), 2), _mm_set1_epi8(0x3F))) };
+
+		//Pixels that have found their end stop counting, the last step ends the search for all of them
+		auto findEnds = [&](int direction, __m128i& isEndDarker)
+		{
+			__m128i distance{ _mm_setzero_si128() };
+			__m128i isEnded{ _mm_xor_si128(isEdge, allSet) };
+			for (int step{ 1 }; step <= g_SearchDistance; ++step)
+			{
+				const int offset{ step * direction };
+				const int row{ std::clamp(y + offset, 0, m_Height - 1) - y };
+
+				const __m128i line{ _mm_blendv_epi8(loadLuma(offset, 0), loadLuma(0, row), isVertical) };
+				const __m128i across{ _mm_blendv_epi8(
+					_mm_blendv_epi8(loadLuma(offset, 1), loadLuma(1, row), isVertical),
+					_mm_blendv_epi8(loadLuma(offset, -1), loadLuma(-1, row), isVertical), isAcrossNegative) };
+				const __m128i average{ _mm_avg_epu8(line, across) };
+
+				const __m128i isEnd{ step == g_SearchDistance ? allSet : isGreaterOrEqual(getDifference(average, edgeLuma), endThreshold) };
+				const __m128i isNewEnd{ _mm_andnot_si128(isEnded, isEnd) };
+				distance = _mm_blendv_epi8(distance, _mm_set1_epi8(char(step)), isNewEnd);
+				isEndDarker = _mm_blendv_epi8(isEndDarker, _mm_xor_si128(isGreaterOrEqual(average, edgeLuma), allSet), isNewEnd);
+
+				isEnded = _mm_or_si128(isEnded, isEnd);
+				if (_mm_movemask_epi8(isEnded) == 0xFFFF) break;
+			}
+			return distance;
+		};
+
+		__m128i isNegativeEndDarker{}, isPositiveEndDarker{};
+		const __m128i negativeDistance{ findEnds(-1, isNegativeEndDarker) };
+		const __m128i positiveDistance{ findEnds(1, isPositiveEndDarker) };
+
+		const __m128i isEndDarker{ _mm_blendv_epi8(isPositiveEndDarker, isNegativeEndDarker, _mm_cmpgt_epi8(positiveDistance, negativeDistance)) };
+		const __m128i isCenterDarker{ _mm_xor_si128(isGreaterOrEqual(center, edgeLuma), allSet) };
+		const __m128i isStepping{ _mm_xor_si128(isEndDarker, isCenterDarker) };
+
+		//The weights are worked out in floats for 8 pixels at a time, sums that fit in 16 bits are added up before that
+		const uint32_t* pSourceRow{ pSource + size_t(y) * m_Width + x };
+		const __m128i zero{ _mm_setzero_si128() };
+		for (int half{ 0 }; half < 2; ++half)
+		{
+			const bool isHigh{ half == 1 };
+			auto widen = [&](__m128i bytes) { return isHigh ? _mm_unpackhi_epi8(bytes, zero) : _mm_unpacklo_epi8(bytes, zero); };
+			auto widenMask = [&](__m128i bytes) { return isHigh ? _mm_unpackhi_epi8(bytes, bytes) : _mm_unpacklo_epi8(bytes, bytes); };
+			auto toFloats = [](__m128i shorts, bool isSigned)
+			{
+				const __m128i low{ isSigned ? _mm_cvtepi16_epi32(shorts) : _mm_cvtepu16_epi32(shorts) };
+				const __m128i high{ isSigned ? _mm_cvtepi16_epi32(_mm_srli_si128(shorts, 8)) : _mm_cvtepu16_epi32(_mm_srli_si128(shorts, 8)) };
+				return _mm256_insertf128_si256(_mm256_castsi128_si256(low), high, 1);
+			};
+
+			const __m256 closest{ _mm256_cvtepi32_ps(toFloats(widen(_mm_min_epu8(negativeDistance, positiveDistance)), false)) };
+			const __m256 distances{ _mm256_cvtepi32_ps(toFloats(widen(_mm_add_epi8(negativeDistance, positiveDistance)), false)) };
+			const __m256 isStepping8{ _mm256_castsi256_ps(toFloats(widenMask(isStepping), true)) };
+			__m256 blend{ _mm256_and_ps(_mm256_sub_ps(_mm256_set1_ps(0.5f), _mm256_div_ps(closest, distances)), isStepping8) };
+
+			const __m128i sides{ _mm_add_epi16(_mm_add_epi16(widen(north), widen(south)), _mm_add_epi16(widen(west), widen(east))) };
+			const __m128i corners{ _mm_add_epi16(_mm_add_epi16(widen(northWest), widen(northEast)), _mm_add_epi16(widen(southWest), widen(southEast))) };
+			const __m256 average{ _mm256_div_ps(_mm256_cvtepi32_ps(toFloats(_mm_add_epi16(_mm_add_epi16(sides, sides), corners), false)), _mm256_set1_ps(12.f)) };
+			const __m256 difference{ _mm256_andnot_ps(_mm256_set1_ps(-0.f), _mm256_sub_ps(average, _mm256_cvtepi32_ps(toFloats(widen(center), false)))) };
+			const __m256 subpixel{ _mm256_min_ps(_mm256_div_ps(difference, _mm256_cvtepi32_ps(toFloats(widen(contrast), false))), _mm256_set1_ps(1.f)) };
+			const __m256 smoothSubpixel{ _mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(3.f), _mm256_mul_ps(_mm256_set1_ps(2.f), subpixel)), subpixel), subpixel) };
+			blend = _mm256_max_ps(blend, _mm256_mul_ps(_mm256_mul_ps(smoothSubpixel, smoothSubpixel), _mm256_set1_ps(g_SubpixelBlend)));
+
+			//Pixels that aren't on an edge get a weight of 0, which leaves them as they are
+			const __m256i weights8{ _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(blend, _mm256_set1_ps(256.f)), _mm256_set1_ps(0.5f))) };
+			const __m128i weights{ _mm_and_si128(_mm_packs_epi32(_mm256_castsi256_si128(weights8), _mm256_extractf128_si256(weights8, 1)), widenMask(isEdge)) };
+
+			//4 pixels at a time, with every weight repeated for the 4 channels of its pixel
+			for (int quarter{ 0 }; quarter < 2; ++quarter)
+			{
+				const bool isSecond{ quarter == 1 };
+				const int first{ half * 8 + quarter * 4 };
+				auto load = [&](int offsetX, int offsetY)
+				{
+					return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSourceRow + first + offsetX + offsetY * m_Width));
+				};
+				auto spreadMask = [&](__m128i bytes)
+				{
+					const __m128i shorts{ widenMask(bytes) };
+					return isSecond ? _mm_unpackhi_epi16(shorts, shorts) : _mm_unpacklo_epi16(shorts, shorts);
+				};
+
+				const __m128i pixelWeights{ isSecond ? _mm_unpackhi_epi16(weights, weights) : _mm_unpacklo_epi16(weights, weights) };
+				const __m128i centerColors{ load(0, 0) };
+				if (_mm_testz_si128(pixelWeights, pixelWeights))
+				{
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(pDestinationRow + x + first), centerColors);
+					continue;
+				}
+
+				const __m128i isPixelVertical{ spreadMask(isVertical) };
+				const __m128i otherColors{ _mm_blendv_epi8(
+					_mm_blendv_epi8(load(0, 1), load(1, 0), isPixelVertical),
+					_mm_blendv_epi8(load(0, -1), load(-1, 0), isPixelVertical), spreadMask(isAcrossNegative)) };
+
+				auto blendChannels = [&](bool isHighPair)
+				{
+					auto unpack = [&](__m128i colors) { return isHighPair ? _mm_unpackhi_epi8(colors, zero) : _mm_unpacklo_epi8(colors, zero); };
+					const __m128i otherWeights{ isHighPair ? _mm_unpackhi_epi32(pixelWeights, pixelWeights) : _mm_unpacklo_epi32(pixelWeights, pixelWeights) };
+					const __m128i centerWeights{ _mm_sub_epi16(_mm_set1_epi16(256), otherWeights) };
+					//Both products fit 16 bits as long as they're read as unsigned, so does their sum
+					const __m128i sum{ _mm_add_epi16(_mm_mullo_epi16(unpack(centerColors), centerWeights), _mm_mullo_epi16(unpack(otherColors), otherWeights)) };
+					return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+				};
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pDestinationRow + x + first), _mm_packus_epi16(blendChannels(false), blendChannels(true)));
+			}
+		}
+	}
+#endif
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <immintrin.h>
+#include <vector>
+
+namespace dae
+{
+	class JobSystem;
+
+	//Anti-aliasing after the fact in the spirit of FXAA. Edges are found by the contrast in green, which is close enough to brightness,
+	//and every pixel on one is blended with its neighbour across the edge by how far it is from the end of the edge.
+	//Pixels that aren't on an edge are copied as they are, rows are spread over the job system
+	class EdgeAntialiaser final
+	{
+	public:
+		explicit EdgeAntialiaser(JobSystem* pJobSystem);
+
+		//Both images are 32 bits per pixel with their rows packed, width pixels apart. greenShift is where green is in a pixel
+		void Apply(const uint32_t* pSource, uint32_t* pDestination, int width, int height, int greenShift);
+
+	private:
+		JobSystem* m_pJobSystem{};
+
+		int m_Width{};
+		int m_Height{};
+
+		//Green of every source pixel, looking for edges only ever needs this
+		std::vector<uint8_t> m_Luma{};
+
+		void ComputeLuma(const uint32_t* pSource, int y, int greenShift);
+		void FilterRow(const uint32_t* pSource, uint32_t* pDestination, int y) const;
+
+		//Coordinates outside of the image are moved to the closest pixel on its border
+		int GetLuma(int x, int y) const;
+		bool IsEdge(int x, int y) const;
+		uint32_t FilterPixel(const uint32_t* pSource, int x, int y) const;
+		//FilterPixel for the 16 pixels from x on, isEdge has a byte for each of them. Pixels that aren't on an edge are copied
+		void FilterEdges(const uint32_t* pSource, uint32_t* pDestinationRow, int x, int y, __m128i isEdge) const;
+	};
+}
@@ -0,0 +1,124 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+#include "JobSystem.h"
+
+namespace dae
+{
+	namespace
+	{
+		//Enough for anything SIMD loads and for keeping blocks off each other's cache lines
+		constexpr size_t g_BlockAlignment{ 64 };
+
+		uint8_t* AllocateBlock(size_t size)
+		{
+			return static_cast<uint8_t*>(::operator new(size, std::align_val_t{ g_BlockAlignment }));
+		}
+	}
+
+	FrameArena::FrameArena(int nrThreads, size_t blockSize) :
+		m_BlockSize{ blockSize },
+		m_ThreadArenas(std::max(nrThreads, 1))
+	{
+		//Growing the lists of blocks would be a heap allocation of its own
+		m_Blocks.reserve(256);
+		m_LargeBlocks.reserve(16);
+	}
+
+	FrameArena::~FrameArena()
+	{
+		for (const std::vector<Block>* pBlocks : { &m_Blocks, &m_LargeBlocks })
+			for (const Block& block : *pBlocks)
+				::operator delete(block.pData, std::align_val_t{ g_BlockAlignment });
+	}
+
+	void* FrameArena::Allocate(size_t size, size_t alignment)
+	{
+		assert(alignment <= g_BlockAlignment && (alignment & (alignment - 1)) == 0 && "Alignment has to be a power of 2 the blocks can provide");
+		assert(JobSystem::GetThreadIndex() < int(m_ThreadArenas.size()) && "The arena has fewer threads than the job system");
+
+		ThreadArena& arena{ m_ThreadArenas[JobSystem::GetThreadIndex()] };
+
+		while (true)
+		{
+			const size_t alignedOffset{ (arena.offset + alignment - 1) & ~(alignment - 1) };
+			if (arena.block.pData && alignedOffset + size <= arena.block.size)
+			{
+				arena.offset = alignedOffset + size;
+				arena.nrBytesUsed += size;
+				return arena.block.pData + alignedOffset;
+			}
+
+			NextBlock(arena, size);
+		}
+	}
+
+	void FrameArena::Reset()
+	{
+		for (ThreadArena& arena : m_ThreadArenas)
+		{
+			arena.block = {};
+			arena.offset = 0;
+			arena.nrBytesUsed = 0;
+		}
+
+		//A frame that ran out leaves room for half as much again, so the next ones can need a little more without going to the heap.
+		//Every thread can end a frame with a block it barely used, how many of those there are depends on how the work got spread
+		if (m_HasRunOut)
+		{
+			const size_t nrBlocksWanted{ m_NrBlocksTaken + m_NrBlocksTaken / 2 + m_ThreadArenas.size() };
+			while (m_Blocks.size() < nrBlocksWanted)
+				m_Blocks.push_back({ AllocateBlock(m_BlockSize), m_BlockSize });
+		}
+
+		m_HasRunOut = false;
+		m_NrBlocksTaken = 0;
+		m_NrLargeBlocksTaken = 0;
+	}
+
+	size_t FrameArena::GetNrBytesUsed() const
+	{
+		size_t nrBytesUsed{ 0 };
+		for (const ThreadArena& arena : m_ThreadArenas)
+			nrBytesUsed += arena.nrBytesUsed;
+		return nrBytesUsed;
+	}
+
+	void FrameArena::NextBlock(ThreadArena& arena, size_t minSize)
+	{
+		std::lock_guard lock{ m_PoolMutex };
+		arena.offset = 0;
+
+		if (minSize <= m_BlockSize)
+		{
+			if (m_NrBlocksTaken == m_Blocks.size())
+			{
+				m_Blocks.push_back({ AllocateBlock(m_BlockSize), m_BlockSize });
+				m_HasRunOut = true;
+			}
+
+			arena.block = m_Blocks[m_NrBlocksTaken++];
+			return;
+		}
+
+		//The smallest free one that fits, a new one gets some room to spare for when the allocation grows
+		size_t bestIndex{ m_LargeBlocks.size() };
+		for (size_t i{ m_NrLargeBlocksTaken }; i < m_LargeBlocks.size(); ++i)
+		{
+			if (m_LargeBlocks[i].size >= minSize && (bestIndex == m_LargeBlocks.size() || m_LargeBlocks[i].size < m_LargeBlocks[bestIndex].size))
+				bestIndex = i;
+		}
+
+		if (bestIndex == m_LargeBlocks.size())
+		{
+			const size_t size{ (minSize + minSize / 2 + m_BlockSize - 1) / m_BlockSize * m_BlockSize };
+			m_LargeBlocks.push_back({ AllocateBlock(size), size });
+		}
+
+		std::swap(m_LargeBlocks[bestIndex], m_LargeBlocks[m_NrLargeBlocksTaken]);
+		arena.block = m_LargeBlocks[m_NrLargeBlocksTaken++];
+	}
+}
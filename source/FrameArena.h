@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace dae
+{
+	//Bump allocator for data that only lives for one frame. Every thread of the job system allocates from a block of its own,
+	//so allocating only takes a lock when a thread needs its next block. The blocks come from one pool all threads share:
+	//however the work ends up spread over the threads, the pool grows to what a whole frame needs.
+	//Reset hands everything back at once and keeps the blocks, after the first few frames nothing gets allocated from the heap anymore
+	class FrameArena final
+	{
+	public:
+		FrameArena(int nrThreads, size_t blockSize = size_t(1) << 20);
+		~FrameArena();
+
+		FrameArena(const FrameArena&) = delete;
+		FrameArena(FrameArena&&) noexcept = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+		FrameArena& operator=(FrameArena&&) noexcept = delete;
+
+		//Uninitialized memory for the calling thread, valid until the next Reset
+		void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+		template<typename T>
+		T* Allocate(size_t count)
+		{
+			return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+		}
+
+		//Nobody may use anything allocated before anymore
+		void Reset();
+
+		//Bytes handed out since the last Reset, over all threads
+		size_t GetNrBytesUsed() const;
+
+	private:
+		struct Block
+		{
+			uint8_t* pData{};
+			size_t size{};
+		};
+
+		//Padded so threads bumping their own pointer don't share a cache line
+		struct alignas(64) ThreadArena
+		{
+			Block block{};
+			size_t offset{};
+			size_t nrBytesUsed{};
+		};
+
+		size_t m_BlockSize{};
+		std::vector<ThreadArena> m_ThreadArenas{};
+
+		//Only taken to hand out a block
+		std::mutex m_PoolMutex{};
+		//Blocks of the block size, the ones from m_NrBlocksTaken on are still free this frame
+		std::vector<Block> m_Blocks{};
+		size_t m_NrBlocksTaken{};
+		//The pool had to grow while handing out blocks since the last Reset
+		bool m_HasRunOut{};
+		//Blocks for allocations that don't fit the block size, the free ones are at the back as well
+		std::vector<Block> m_LargeBlocks{};
+		size_t m_NrLargeBlocksTaken{};
+
+		//Gives the thread a free block that can hold the allocation, only mallocs when there's none left
+		void NextBlock(ThreadArena& arena, size_t minSize);
+	};
+}
@@ -0,0 +1,232 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "Profiler.h"
+
+namespace dae
+{
+	namespace
+	{
+		thread_local int g_ThreadIndex{ 0 };
+
+		void PinCurrentThread(int threadIndex)
+		{
+			const int core{ threadIndex % std::max(int(std::thread::hardware_concurrency()), 1) };
+#ifdef _WIN32
+			SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core);
+#else
+			cpu_set_t cores{};
+			CPU_ZERO(&cores);
+			CPU_SET(core, &cores);
+			pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores);
+#endif
+		}
+	}
+
+	JobSystem::JobSystem(int nrWorkers, bool pinThreads)
+	{
+		if (nrWorkers <= 0)
+			nrWorkers = std::max(int(std::thread::hardware_concurrency()) - 1, 0);
+
+		for (int i{ 0 }; i <= nrWorkers; ++i)
+			m_pQueues.push_back(std::make_unique<Queue>());
+
+		if (pinThreads)
+			PinCurrentThread(0);
+
+		for (int i{ 1 }; i <= nrWorkers; ++i)
+			m_Workers.emplace_back(&JobSystem::WorkerLoop, this, i, pinThreads);
+	}
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard lock{ m_SleepMutex };
+			m_IsQuitting = true;
+		}
+		m_WakeCondition.notify_all();
+
+		for (std::thread& worker : m_Workers)
+			worker.join();
+	}
+
+	void JobSystem::Run(const JobFunction& function, JobCounter* pCounter)
+	{
+		if (pCounter)
+			pCounter->m_NrPending.fetch_add(1);
+
+		Push({ function, pCounter });
+	}
+
+	void JobSystem::RunAfter(JobCounter& dependency, const JobFunction& function, JobCounter* pCounter)
+	{
+		if (pCounter)
+			pCounter->m_NrPending.fetch_add(1);
+
+		{
+			std::lock_guard lock{ dependency.m_Mutex };
+			if (dependency.m_NrPending.load() > 0)
+			{
+				dependency.m_Continuations.push_back({ function, pCounter });
+				return;
+			}
+		}
+
+		Push({ function, pCounter });
+	}
+
+	void JobSystem::Wait(JobCounter& counter)
+	{
+		const int threadIndex{ GetThreadIndex() };
+		while (!counter.IsDone())
+		{
+			if (!TryRunJob(threadIndex))
+				std::this_thread::yield();
+		}
+
+		//The last job may still be releasing the counter, it's only safe to throw it away once that's over
+		std::lock_guard lock{ counter.m_Mutex };
+	}
+
+	int JobSystem::GetThreadIndex()
+	{
+		return g_ThreadIndex;
+	}
+
+	void JobSystem::WorkerLoop(int threadIndex, bool pinThread)
+	{
+		g_ThreadIndex = threadIndex;
+		if (pinThread)
+			PinCurrentThread(threadIndex);
+
+		Profiler::GetInstance().SetThreadName("Worker " + std::to_string(threadIndex));
+
+		while (!m_IsQuitting)
+		{
+			if (TryRunJob(threadIndex))
+				continue;
+
+			std::unique_lock lock{ m_SleepMutex };
+			++m_NrSleepingWorkers;
+			m_WakeCondition.wait(lock, [this]() { return m_NrQueuedJobs.load() > 0 || m_IsQuitting; });
+			--m_NrSleepingWorkers;
+		}
+	}
+
+	void JobSystem::Push(const Job& job)
+	{
+		//Counted before it's in a queue, so the count is never lower than what can be taken.
+		//Either a worker going to sleep sees the job in its wait condition or we see it sleeping here
+		m_NrQueuedJobs.fetch_add(1);
+
+		Queue& queue{ *m_pQueues[std::min(GetThreadIndex(), GetNrThreads() - 1)] };
+		{
+			std::lock_guard lock{ queue.mutex };
+			queue.PushBack(job);
+		}
+
+		if (m_NrSleepingWorkers.load() > 0)
+		{
+			{
+				std::lock_guard lock{ m_SleepMutex };
+			}
+			m_WakeCondition.notify_one();
+		}
+	}
+
+	bool JobSystem::TryRunJob(int threadIndex)
+	{
+		if (m_NrQueuedJobs.load() == 0)
+			return false;
+
+		Job job{};
+		bool hasJob{ false };
+
+		//Newest job of our own first, it's the one most likely still in the cache
+		{
+			Queue& queue{ *m_pQueues[threadIndex] };
+			std::lock_guard lock{ queue.mutex };
+			if (queue.count > 0)
+			{
+				job = queue.PopBack();
+				hasJob = true;
+			}
+		}
+
+		//Then the oldest one of someone else
+		for (int offset{ 1 }; offset < GetNrThreads() && !hasJob; ++offset)
+		{
+			Queue& queue{ *m_pQueues[(threadIndex + offset) % GetNrThreads()] };
+			std::lock_guard lock{ queue.mutex };
+			if (queue.count > 0)
+			{
+				job = queue.PopFront();
+				hasJob = true;
+			}
+		}
+
+		if (!hasJob)
+			return false;
+
+		m_NrQueuedJobs.fetch_sub(1);
+		job.function();
+		Finish(job.pCounter);
+		return true;
+	}
+
+	void JobSystem::Finish(JobCounter* pCounter)
+	{
+		if (!pCounter)
+			return;
+
+		std::vector<Job> continuations{};
+		{
+			std::lock_guard lock{ pCounter->m_Mutex };
+			if (pCounter->m_NrPending.fetch_sub(1) == 1)
+				continuations.swap(pCounter->m_Continuations);
+		}
+
+		for (const Job& continuation : continuations)
+			Push(continuation);
+	}
+
+	void JobSystem::Queue::PushBack(const Job& job)
+	{
+		//Full, the jobs move to a ring twice the size in the order they'd be taken
+		if (count == jobs.size())
+		{
+			std::vector<Job> grown(jobs.size() * 2);
+			for (size_t i{ 0 }; i < count; ++i)
+				grown[i] = jobs[(first + i) % jobs.size()];
+			jobs.swap(grown);
+			first = 0;
+		}
+
+		jobs[(first + count) % jobs.size()] = job;
+		++count;
+	}
+
+	Job JobSystem::Queue::PopBack()
+	{
+		--count;
+		return jobs[(first + count) % jobs.size()];
+	}
+
+	Job JobSystem::Queue::PopFront()
+	{
+		const Job job{ jobs[first] };
+		first = (first + 1) % jobs.size();
+		--count;
+		return job;
+	}
+}
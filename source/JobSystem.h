@@ -0,0 +1,164 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace dae
+{
+	class JobCounter;
+
+	//Callable that lives inside the job itself, so queueing a job never allocates.
+	//What it captures has to fit and be trivially copyable, which lambdas capturing pointers, references and plain values are
+	class JobFunction final
+	{
+	public:
+		JobFunction() = default;
+
+		template<typename Function>
+		JobFunction(const Function& function)
+		{
+			static_assert(sizeof(Function) <= sizeof(m_Storage), "Too much captured, capture a pointer to the data instead");
+			static_assert(std::is_trivially_copyable_v<Function>, "Jobs are copied around as plain bytes");
+
+			new (m_Storage) Function{ function };
+			m_pInvoke = [](const void* pStorage) { (*static_cast<const Function*>(pStorage))(); };
+		}
+
+		void operator()() const { m_pInvoke(m_Storage); }
+
+	private:
+		void (*m_pInvoke)(const void* pStorage) {};
+		alignas(std::max_align_t) unsigned char m_Storage[48]{};
+	};
+
+	struct Job
+	{
+		JobFunction function{};
+		//Goes down by one once the function returned
+		JobCounter* pCounter{};
+	};
+
+	//Number of unfinished jobs of a group. Waiting for it to reach 0 is the join,
+	//jobs can also be queued to start only once it got there
+	class JobCounter final
+	{
+	public:
+		JobCounter() = default;
+		~JobCounter() = default;
+
+		JobCounter(const JobCounter&) = delete;
+		JobCounter(JobCounter&&) noexcept = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+		JobCounter& operator=(JobCounter&&) noexcept = delete;
+
+		bool IsDone() const { return m_NrPending.load(std::memory_order_acquire) == 0; }
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<int> m_NrPending{ 0 };
+
+		//Guards the jobs waiting for this counter, and the last decrement so the counter outlives it
+		std::mutex m_Mutex{};
+		std::vector<Job> m_Continuations{};
+	};
+
+	//Work stealing scheduler, every thread has its own queue and takes from the back of it,
+	//threads that ran out of work take from the front of the others.
+	//The thread that creates the system is thread 0 and runs jobs whenever it waits for them
+	class JobSystem final
+	{
+	public:
+		//0 workers means one per hardware thread besides the one creating the system.
+		//Pinning puts every thread on a core of its own
+		explicit JobSystem(int nrWorkers = 0, bool pinThreads = false);
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem(JobSystem&&) noexcept = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+		JobSystem& operator=(JobSystem&&) noexcept = delete;
+
+		//Fork, the counter goes up right away and down once the job is done
+		void Run(const JobFunction& function, JobCounter* pCounter = nullptr);
+
+		//Same as Run, but the job only gets queued once the dependency has nothing pending anymore
+		void RunAfter(JobCounter& dependency, const JobFunction& function, JobCounter* pCounter = nullptr);
+
+		//Join, the calling thread runs queued jobs until the counter reaches 0
+		void Wait(JobCounter& counter);
+
+		//Calls body(first, last) for ranges of at most grainSize out of [0, count) and returns once all of them are done.
+		//The calling thread does its share, so nesting it inside of jobs is fine
+		template<typename Body>
+		void ParallelFor(size_t count, size_t grainSize, const Body& body)
+		{
+			if (count == 0)
+				return;
+
+			grainSize = std::max(grainSize, size_t(1));
+			const size_t nrRanges{ (count + grainSize - 1) / grainSize };
+			if (nrRanges == 1 || m_Workers.empty())
+			{
+				body(size_t(0), count);
+				return;
+			}
+
+			//Only a pointer to the body goes into the jobs, it stays alive until Wait returns
+			const Body* pBody{ &body };
+			JobCounter counter{};
+			for (size_t range{ 1 }; range < nrRanges; ++range)
+			{
+				Run([pBody, range, grainSize, count]()
+					{
+						(*pBody)(range * grainSize, std::min(count, (range + 1) * grainSize));
+					}, &counter);
+			}
+
+			body(size_t(0), grainSize);
+			Wait(counter);
+		}
+
+		//Workers plus the thread that created the system
+		int GetNrThreads() const { return int(m_pQueues.size()); }
+
+		//Index of the calling thread, threads that aren't workers count as thread 0
+		static int GetThreadIndex();
+
+	private:
+		//Ring buffer that only ever grows, once it's big enough queueing doesn't allocate anymore
+		struct alignas(64) Queue
+		{
+			std::mutex mutex{};
+			std::vector<Job> jobs{ std::vector<Job>(256) };
+			size_t first{};
+			size_t count{};
+
+			void PushBack(const Job& job);
+			Job PopBack();
+			Job PopFront();
+		};
+
+		std::vector<std::unique_ptr<Queue>> m_pQueues{};
+		std::vector<std::thread> m_Workers{};
+
+		//Workers sleep when nothing's queued anywhere
+		std::atomic<int> m_NrQueuedJobs{ 0 };
+		std::atomic<int> m_NrSleepingWorkers{ 0 };
+		std::mutex m_SleepMutex{};
+		std::condition_variable m_WakeCondition{};
+		std::atomic<bool> m_IsQuitting{ false };
+
+		void WorkerLoop(int threadIndex, bool pinThread);
+		void Push(const Job& job);
+		bool TryRunJob(int threadIndex);
+		void Finish(JobCounter* pCounter);
+	};
+}
@@ -4,8 +4,58 @@
 
 #include "MathHelpers.h"
 #include <cmath>
+#include <emmintrin.h>
 
 namespace dae {
+	namespace
+	{
+		inline __m128 Load(const Vector4& v)
+		{
+			return _mm_load_ps(&v.x);
+		}
+
+		inline void Store(Vector4& v, __m128 value)
+		{
+			_mm_store_ps(&v.x, value);
+		}
+
+		//x * row0 + y * row1 + z * row2 + w * row3
+		inline __m128 Combine(__m128 x, __m128 y, __m128 z, __m128 w, const Vector4 rows[4])
+		{
+			__m128 result{ _mm_mul_ps(x, Load(rows[0])) };
+			result = _mm_add_ps(result, _mm_mul_ps(y, Load(rows[1])));
+			result = _mm_add_ps(result, _mm_mul_ps(z, Load(rows[2])));
+			return _mm_add_ps(result, _mm_mul_ps(w, Load(rows[3])));
+		}
+
+		inline __m128 Splat(__m128 v, int lane)
+		{
+			switch (lane)
+			{
+			case 0: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0));
+			case 1: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1));
+			case 2: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2));
+			default: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+			}
+		}
+
+		//Cross product of the xyz lanes, w ends up 0
+		inline __m128 Cross3(__m128 a, __m128 b)
+		{
+			const __m128 aYZX{ _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1)) };
+			const __m128 bYZX{ _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1)) };
+			const __m128 result{ _mm_sub_ps(_mm_mul_ps(a, bYZX), _mm_mul_ps(aYZX, b)) };
+			return _mm_shuffle_ps(result, result, _MM_SHUFFLE(3, 0, 2, 1));
+		}
+
+		inline float Dot3(__m128 a, __m128 b)
+		{
+			const __m128 product{ _mm_mul_ps(a, b) };
+			const __m128 sum{ _mm_add_ss(_mm_add_ss(product, Splat(product, 1)), Splat(product, 2)) };
+			return _mm_cvtss_f32(sum);
+		}
+	}
+
 	Matrix::Matrix(const Vector3& xAxis, const Vector3& yAxis, const Vector3& zAxis, const Vector3& t) :
 		Matrix({ xAxis, 0 }, { yAxis, 0 }, { zAxis, 0 }, { t, 1 })
 	{
@@ -21,10 +71,10 @@ namespace dae {
 
 	Matrix::Matrix(const Matrix& m)
 	{
-		data[0] = m[0];
-		data[1] = m[1];
-		data[2] = m[2];
-		data[3] = m[3];
+		Store(data[0], Load(m.data[0]));
+		Store(data[1], Load(m.data[1]));
+		Store(data[2], Load(m.data[2]));
+		Store(data[3], Load(m.data[3]));
 	}
 
 	Vector3 Matrix::TransformVector(const Vector3& v) const
@@ -34,11 +84,9 @@ namespace dae {
 
 	Vector3 Matrix::TransformVector(float x, float y, float z) const
 	{
-		return Vector3{
-			data[0].x * x + data[1].x * y + data[2].x * z,
-			data[0].y * x + data[1].y * y + data[2].y * z,
-			data[0].z * x + data[1].z * y + data[2].z * z
-		};
+		Vector4 result;
+		Store(result, Combine(_mm_set1_ps(x), _mm_set1_ps(y), _mm_set1_ps(z), _mm_setzero_ps(), data));
+		return result.GetXYZ();
 	}
 
 	Vector3 Matrix::TransformPoint(const Vector3& p) const
@@ -48,43 +96,40 @@ namespace dae {
 
 	Vector3 Matrix::TransformPoint(float x, float y, float z) const
 	{
-		return Vector3{
-			data[0].x * x + data[1].x * y + data[2].x * z + data[3].x,
-			data[0].y * x + data[1].y * y + data[2].y * z + data[3].y,
-			data[0].z * x + data[1].z * y + data[2].z * z + data[3].z,
-		};
+		Vector4 result;
+		Store(result, Combine(_mm_set1_ps(x), _mm_set1_ps(y), _mm_set1_ps(z), _mm_set1_ps(1.f), data));
+		return result.GetXYZ();
 	}
 
 	Vector4 Matrix::TransformPoint(const Vector4& p) const
 	{
-		return TransformPoint(p.x, p.y, p.z, p.w);
+		const __m128 point{ Load(p) };
+
+		Vector4 result;
+		Store(result, Combine(Splat(point, 0), Splat(point, 1), Splat(point, 2), Splat(point, 3), data));
+		return result;
 	}
 
 	Vector4 Matrix::TransformPoint(float x, float y, float z, float w) const
 	{
-		return Vector4{
-			data[0].x * x + data[1].x * y + data[2].x * z + data[3].x,
-			data[0].y * x + data[1].y * y + data[2].y * z + data[3].y,
-			data[0].z * x + data[1].z * y + data[2].z * z + data[3].z,
-			data[0].w * x + data[1].w * y + data[2].w * z + data[3].w
-		};
+		Vector4 result;
+		Store(result, Combine(_mm_set1_ps(x), _mm_set1_ps(y), _mm_set1_ps(z), _mm_set1_ps(w), data));
+		return result;
 	}
 
 	const Matrix& Matrix::Transpose()
 	{
-		Matrix result{};
-		for (int r{ 0 }; r < 4; ++r)
-		{
-			for (int c{ 0 }; c < 4; ++c)
-			{
-				result[r][c] = data[c][r];
-			}
-		}
+		__m128 row0{ Load(data[0]) };
+		__m128 row1{ Load(data[1]) };
+		__m128 row2{ Load(data[2]) };
+		__m128 row3{ Load(data[3]) };
 
-		data[0] = result[0];
-		data[1] = result[1];
-		data[2] = result[2];
-		data[3] = result[3];
+		_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+
+		Store(data[0], row0);
+		Store(data[1], row1);
+		Store(data[2], row2);
+		Store(data[3], row3);
 
 		return *this;
 	}
@@ -92,36 +137,41 @@ namespace dae {
 	const Matrix& Matrix::Inverse()
 	{
 		//Optimized Inverse as explained in FGED1 - used widely in other libraries too.
-		const Vector3& a = data[0];
-		const Vector3& b = data[1];
-		const Vector3& c = data[2];
-		const Vector3& d = data[3];
-
-		const float x = data[0][3];
-		const float y = data[1][3];
-		const float z = data[2][3];
-		const float w = data[3][3];
-
-		Vector3 s = Vector3::Cross(a, b);
-		Vector3 t = Vector3::Cross(c, d);
-		Vector3 u = a * y - b * x;
-		Vector3 v = c * w - d * z;
-
-		float det = Vector3::Dot(s, v) + Vector3::Dot(t, u);
+		//The xyz lanes hold the vectors, the w lanes are masked out so the cross products stay 3D
+		const __m128 xyzMask{ _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0)) };
+		const __m128 a{ _mm_and_ps(Load(data[0]), xyzMask) };
+		const __m128 b{ _mm_and_ps(Load(data[1]), xyzMask) };
+		const __m128 c{ _mm_and_ps(Load(data[2]), xyzMask) };
+		const __m128 d{ _mm_and_ps(Load(data[3]), xyzMask) };
+
+		const __m128 x{ _mm_set1_ps(data[0][3]) };
+		const __m128 y{ _mm_set1_ps(data[1][3]) };
+		const __m128 z{ _mm_set1_ps(data[2][3]) };
+		const __m128 w{ _mm_set1_ps(data[3][3]) };
+
+		__m128 s{ Cross3(a, b) };
+		__m128 t{ Cross3(c, d) };
+		__m128 u{ _mm_sub_ps(_mm_mul_ps(a, y), _mm_mul_ps(b, x)) };
+		__m128 v{ _mm_sub_ps(_mm_mul_ps(c, w), _mm_mul_ps(d, z)) };
+
+		const float det = Dot3(s, v) + Dot3(t, u);
 		assert((!AreEqual(det, 0.f)) && "ERROR: determinant is 0, there is no INVERSE!");
-		float invDet = 1.f / det;
+		const __m128 invDet{ _mm_set1_ps(1.f / det) };
+
+		s = _mm_mul_ps(s, invDet); t = _mm_mul_ps(t, invDet); u = _mm_mul_ps(u, invDet); v = _mm_mul_ps(v, invDet);
 
-		s *= invDet; t *= invDet; u *= invDet; v *= invDet;
+		__m128 r0{ _mm_add_ps(Cross3(b, v), _mm_mul_ps(t, y)) };
+		__m128 r1{ _mm_sub_ps(Cross3(v, a), _mm_mul_ps(t, x)) };
+		__m128 r2{ _mm_add_ps(Cross3(d, u), _mm_mul_ps(s, w)) };
+		__m128 r3{ _mm_sub_ps(Cross3(u, c), _mm_mul_ps(s, z)) };
 
-		Vector3 r0 = Vector3::Cross(b, v) + t * y;
-		Vector3 r1 = Vector3::Cross(v, a) - t * x;
-		Vector3 r2 = Vector3::Cross(d, u) + s * w;
-		Vector3 r3 = Vector3::Cross(u, c) - s * z;
+		//r0-r3 are the columns of the inverse, the last row holds the translation part
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
 
-		data[0] = Vector4{ r0.x, r1.x, r2.x, 0.f };
-		data[1] = Vector4{ r0.y, r1.y, r2.y, 0.f };
-		data[2] = Vector4{ r0.z, r1.z, r2.z, 0.f };
-		data[3] = { { -Vector3::Dot(b, t)},{Vector3::Dot(a, t)},{-Vector3::Dot(d, s)},{Vector3::Dot(c, s)} };
+		Store(data[0], r0);
+		Store(data[1], r1);
+		Store(data[2], r2);
+		data[3] = { -Dot3(b, t), Dot3(a, t), -Dot3(d, s), Dot3(c, s) };
 
 		return *this;
 	}
@@ -265,15 +315,12 @@ namespace dae {
 
 	Matrix Matrix::operator*(const Matrix& m) const
 	{
+		//Every row of the result is a combination of the rows of m, weighted by the same row of this matrix
 		Matrix result{};
-		Matrix m_transposed = Transpose(m);
-
 		for (int r{ 0 }; r < 4; ++r)
 		{
-			for (int c{ 0 }; c < 4; ++c)
-			{
-				result[r][c] = Vector4::Dot(data[r], m_transposed[c]);
-			}
+			const __m128 row{ Load(data[r]) };
+			Store(result.data[r], Combine(Splat(row, 0), Splat(row, 1), Splat(row, 2), Splat(row, 3), m.data));
 		}
 
 		return result;
@@ -281,16 +328,8 @@ namespace dae {
 
 	const Matrix& Matrix::operator*=(const Matrix& m)
 	{
-		Matrix copy{ *this };
-		Matrix m_transposed = Transpose(m);
-
-		for (int r{ 0 }; r < 4; ++r)
-		{
-			for (int c{ 0 }; c < 4; ++c)
-			{
-				data[r][c] = Vector4::Dot(copy[r], m_transposed[c]);
-			}
-		}
+		//Goes through a temporary so m can be this matrix too
+		*this = *this * m;
 
 		return *this;
 	}
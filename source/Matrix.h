@@ -58,7 +58,7 @@ namespace dae {
 
 	private:
 
-		//Row-Major Matrix
+		//Row-Major Matrix, every row is 16 byte aligned so it can be used as an SSE register
 		Vector4 data[4]
 		{
 			{1,0,0,0}, //xAxis
@@ -0,0 +1,191 @@
+#include "OcclusionBuffer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <immintrin.h>
+
+#include "VertexKernels.h"
+
+namespace dae
+{
+	OcclusionBuffer::OcclusionBuffer(int width, int height) :
+		m_Width{ width },
+		m_Height{ height }
+	{
+		assert(width % 4 == 0 && "The occlusion buffer works on 4 pixels at a time");
+		m_pDepth = new float[size_t(m_Width) * m_Height];
+		Clear();
+	}
+
+	OcclusionBuffer::~OcclusionBuffer()
+	{
+		delete[] m_pDepth;
+	}
+
+	void OcclusionBuffer::Clear()
+	{
+		std::fill(m_pDepth, m_pDepth + size_t(m_Width) * m_Height, FLT_MAX);
+	}
+
+	void OcclusionBuffer::RasterizeOccluder(const Mesh& mesh, const Matrix& worldViewProjection, TransformedPositions& scratch)
+	{
+		//At the resolution of this buffer
+		VertexKernels::TransformPositions(worldViewProjection, m_Width, m_Height, mesh.positions, 0, mesh.positions.x.size(), scratch);
+
+		auto rasterize = [this, &mesh, &scratch](size_t index0, size_t index1, size_t index2)
+		{
+			const uint32_t i0{ mesh.indices[index0] };
+			const uint32_t i1{ mesh.indices[index1] };
+			const uint32_t i2{ mesh.indices[index2] };
+
+			//Only what the renderer itself would draw may hide things, so the same triangles get dropped:
+			//anything with a vertex outside the frustum, and everything reaching behind the camera
+			if (scratch.isOutsideFrustum[i0] | scratch.isOutsideFrustum[i1] | scratch.isOutsideFrustum[i2])
+				return;
+			if (scratch.invW[i0] <= 0.f || scratch.invW[i1] <= 0.f || scratch.invW[i2] <= 0.f)
+				return;
+
+			const float depth{ std::max({ scratch.z[i0], scratch.z[i1], scratch.z[i2] }) };
+			RasterizeTriangle({ scratch.x[i0], scratch.y[i0] }, { scratch.x[i1], scratch.y[i1] },
+				{ scratch.x[i2], scratch.y[i2] }, depth);
+		};
+
+		//Every other triangle of a strip has its winding flipped, like in Renderer::RenderTriangle
+		if (mesh.primitiveTopology == PrimitiveTopology::TriangleList)
+			for (size_t i{ 0 }; i + 2 < mesh.indices.size(); i += 3)
+				rasterize(i, i + 1, i + 2);
+		else
+			for (size_t i{ 0 }; i + 2 < mesh.indices.size(); ++i)
+				rasterize(i % 2 ? i + 2 : i, i + 1, i % 2 ? i : i + 2);
+	}
+
+	bool OcclusionBuffer::IsOccluded(const BoundingBox& worldBounds, const Matrix& viewProjection) const
+	{
+		float minX{ FLT_MAX }, minY{ FLT_MAX }, maxX{ -FLT_MAX }, maxY{ -FLT_MAX };
+		float minDepth{ FLT_MAX };
+
+		for (int corner{ 0 }; corner < 8; ++corner)
+		{
+			const Vector4 point{
+				corner & 1 ? worldBounds.max.x : worldBounds.min.x,
+				corner & 2 ? worldBounds.max.y : worldBounds.min.y,
+				corner & 4 ? worldBounds.max.z : worldBounds.min.z,
+				1.f };
+			const Vector4 clip{ viewProjection.TransformPoint(point) };
+
+			//A box that reaches behind the camera covers the whole screen in some way, never worth the risk
+			if (clip.w <= FLT_EPSILON)
+				return false;
+
+			const float invW{ 1.f / clip.w };
+			const float x{ (clip.x * invW + 1.f) * 0.5f * m_Width };
+			const float y{ (1.f - clip.y * invW) * 0.5f * m_Height };
+
+			minX = std::min(minX, x);
+			maxX = std::max(maxX, x);
+			minY = std::min(minY, y);
+			maxY = std::max(maxY, y);
+			minDepth = std::min(minDepth, clip.z * invW);
+		}
+
+		//Every pixel the box touches and one more all around. Occluders only cover pixel centers, so along an edge of theirs a pixel can be
+		//written while part of it is still open. One of its neighbours always has its center on the open side, requiring that one as well
+		//means what's tested is covered completely and not just at the centers
+		const int firstX{ std::max(int(std::floor(minX)), 0) - 1 };
+		const int lastX{ std::min(int(std::floor(maxX)), m_Width - 1) + 1 };
+		const int firstY{ std::max(int(std::floor(minY)), 0) - 1 };
+		const int lastY{ std::min(int(std::floor(maxY)), m_Height - 1) + 1 };
+
+		//Pixels on the border have neighbours off screen that can't be checked
+		if (firstX < 0 || lastX >= m_Width || firstY < 0 || lastY >= m_Height)
+			return false;
+
+		const __m128 boxDepth{ _mm_set1_ps(minDepth) };
+
+		for (int y{ firstY }; y <= lastY; ++y)
+		{
+			const float* pRow{ m_pDepth + size_t(y) * m_Width };
+
+			int x{ firstX };
+			for (; x + 4 <= lastX + 1; x += 4)
+			{
+				//Any pixel where the box is in front of the occluders means it could be visible
+				if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(pRow + x), boxDepth)))
+					return false;
+			}
+			for (; x <= lastX; ++x)
+				if (pRow[x] >= minDepth)
+					return false;
+		}
+
+		return true;
+	}
+
+	void OcclusionBuffer::RasterizeTriangle(const Vector2& vertex0, const Vector2& vertex1, const Vector2& vertex2, float depth)
+	{
+		//Back faces aren't drawn by the renderer, an open mesh seen from behind hides nothing
+		if (Vector2::Cross(vertex1 - vertex0, vertex2 - vertex0) <= 0.f)
+			return;
+
+		//Pixels whose center is inside the bounding box
+		const int firstX{ std::max(int(std::ceil(std::min({ vertex0.x, vertex1.x, vertex2.x }) - 0.5f)), 0) };
+		const int lastX{ std::min(int(std::floor(std::max({ vertex0.x, vertex1.x, vertex2.x }) - 0.5f)), m_Width - 1) };
+		const int firstY{ std::max(int(std::ceil(std::min({ vertex0.y, vertex1.y, vertex2.y }) - 0.5f)), 0) };
+		const int lastY{ std::min(int(std::floor(std::max({ vertex0.y, vertex1.y, vertex2.y }) - 0.5f)), m_Height - 1) };
+
+		if (firstX > lastX || firstY > lastY)
+			return;
+
+		//Edge functions as a * x + b * y + c, positive on the inside
+		struct Edge
+		{
+			float a, b, c;
+		};
+		auto makeEdge = [](const Vector2& from, const Vector2& to)
+		{
+			const float a{ from.y - to.y };
+			const float b{ to.x - from.x };
+			return Edge{ a, b, -(a * from.x + b * from.y) };
+		};
+		const Edge edges[3]{ makeEdge(vertex0, vertex1), makeEdge(vertex1, vertex2), makeEdge(vertex2, vertex0) };
+
+		const __m128 laneOffsets{ _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f) };
+		const __m128 triangleDepth{ _mm_set1_ps(depth) };
+		const __m128 zero{ _mm_setzero_ps() };
+
+		__m128 edgeA[3];
+		for (int i{ 0 }; i < 3; ++i)
+			edgeA[i] = _mm_set1_ps(edges[i].a);
+
+		//Lanes left of the triangle but inside the group of 4 fail the edge tests by themselves
+		const int alignedFirstX{ firstX & ~3 };
+
+		for (int y{ firstY }; y <= lastY; ++y)
+		{
+			const float pixelY{ y + 0.5f };
+			float* pRow{ m_pDepth + size_t(y) * m_Width };
+
+			__m128 rowStart[3];
+			for (int i{ 0 }; i < 3; ++i)
+				rowStart[i] = _mm_set1_ps(edges[i].b * pixelY + edges[i].c);
+
+			for (int x{ alignedFirstX }; x <= lastX; x += 4)
+			{
+				const __m128 pixelX{ _mm_add_ps(_mm_set1_ps(float(x)), laneOffsets) };
+
+				__m128 inside{ _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[0], pixelX), rowStart[0]), zero) };
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[1], pixelX), rowStart[1]), zero));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[2], pixelX), rowStart[2]), zero));
+
+				if (!_mm_movemask_ps(inside))
+					continue;
+
+				const __m128 current{ _mm_loadu_ps(pRow + x) };
+				const __m128 closest{ _mm_min_ps(current, triangleDepth) };
+				_mm_storeu_ps(pRow + x, _mm_or_ps(_mm_and_ps(inside, closest), _mm_andnot_ps(inside, current)));
+			}
+		}
+	}
+}
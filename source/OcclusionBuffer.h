@@ -0,0 +1,40 @@
+#pragma once
+#include "DataTypes.h"
+
+namespace dae
+{
+	//Small depth buffer that only the designated occluders get rasterized into, used to skip instances hidden behind them.
+	//Every occluder triangle is written with the depth of its furthest vertex into the pixels whose center it covers.
+	//Tests look one pixel further than the box they're given, so anything found behind the occluders really is hidden
+	class OcclusionBuffer final
+	{
+	public:
+		//The width has to be a multiple of 4, rows are handled 4 pixels at a time
+		OcclusionBuffer(int width = 256, int height = 128);
+		~OcclusionBuffer();
+
+		OcclusionBuffer(const OcclusionBuffer&) = delete;
+		OcclusionBuffer(OcclusionBuffer&&) noexcept = delete;
+		OcclusionBuffer& operator=(const OcclusionBuffer&) = delete;
+		OcclusionBuffer& operator=(OcclusionBuffer&&) noexcept = delete;
+
+		void Clear();
+
+		//The scratch streams take the transformed vertices, they need room for every vertex of the mesh
+		void RasterizeOccluder(const Mesh& mesh, const Matrix& worldViewProjection, TransformedPositions& scratch);
+
+		//True when every pixel the box covers already has something closer in it
+		bool IsOccluded(const BoundingBox& worldBounds, const Matrix& viewProjection) const;
+
+		int GetWidth() const { return m_Width; }
+		int GetHeight() const { return m_Height; }
+		const float* GetDepth() const { return m_pDepth; }
+
+	private:
+		int m_Width{};
+		int m_Height{};
+		float* m_pDepth{};
+
+		void RasterizeTriangle(const Vector2& vertex0, const Vector2& vertex1, const Vector2& vertex2, float depth);
+	};
+}
@@ -0,0 +1,44 @@
+#include "Presenter.h"
+
+#include "SDL.h"
+#include "SDL_surface.h"
+
+#include "Profiler.h"
+#include "RenderTarget.h"
+
+namespace dae
+{
+	Presenter::Presenter(RenderTarget* pRenderTarget) :
+		m_pRenderTarget{ pRenderTarget }
+	{
+		m_pBackBuffer = pRenderTarget->GetDrawableSurface();
+		if (m_pBackBuffer)
+			return;
+
+		//Anything that isn't 32 bit can't be drawn in directly, those targets get the old default and convert when presenting
+		const SDL_PixelFormat* pFormat{ pRenderTarget->GetPixelFormat() };
+		const bool canShareFormat{ pFormat && pFormat->BytesPerPixel == 4 };
+
+		m_OwnsBackBuffer = true;
+		m_pBackBuffer = canShareFormat
+			? SDL_CreateRGBSurface(0, pRenderTarget->GetWidth(), pRenderTarget->GetHeight(), 32, pFormat->Rmask, pFormat->Gmask, pFormat->Bmask, pFormat->Amask)
+			: SDL_CreateRGBSurface(0, pRenderTarget->GetWidth(), pRenderTarget->GetHeight(), 32, 0, 0, 0, 0);
+	}
+
+	Presenter::~Presenter()
+	{
+		if (m_OwnsBackBuffer)
+			SDL_FreeSurface(m_pBackBuffer);
+	}
+
+	void Presenter::Present()
+	{
+		PROFILE_SCOPE("Present");
+		m_pRenderTarget->Present(m_pBackBuffer);
+	}
+
+	const SDL_PixelFormat* Presenter::GetPixelFormat() const
+	{
+		return m_pBackBuffer->format;
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+struct SDL_Surface;
+struct SDL_PixelFormat;
+
+namespace dae
+{
+	class RenderTarget;
+
+	//Owns the back buffer frames are drawn in and hands it to the render target, on the thread that draws.
+	//When frames can be drawn in the target's own surface that surface is the back buffer, and presenting doesn't copy anything
+	class Presenter final
+	{
+	public:
+		//A back buffer of its own gets the pixel format of the render target so presenting it is a plain copy
+		explicit Presenter(RenderTarget* pRenderTarget);
+		~Presenter();
+
+		Presenter(const Presenter&) = delete;
+		Presenter(Presenter&&) noexcept = delete;
+		Presenter& operator=(const Presenter&) = delete;
+		Presenter& operator=(Presenter&&) noexcept = delete;
+
+		//Always the same one. Nothing clears it, it still holds whatever frame it showed last
+		SDL_Surface* GetBackBuffer() const { return m_pBackBuffer; }
+
+		//Returns once the render target shows the back buffer
+		void Present();
+
+		const SDL_PixelFormat* GetPixelFormat() const;
+
+	private:
+		RenderTarget* m_pRenderTarget{};
+		SDL_Surface* m_pBackBuffer{};
+		//Otherwise the back buffer is the surface of the render target
+		bool m_OwnsBackBuffer{};
+	};
+}
@@ -0,0 +1,108 @@
+#include "Profiler.h"
+
+#include <fstream>
+#include <iomanip>
+
+namespace dae
+{
+	Profiler& Profiler::GetInstance()
+	{
+		static Profiler profiler{};
+		return profiler;
+	}
+
+	void Profiler::BeginCapture()
+	{
+		std::lock_guard lock{ m_LanesMutex };
+		for (const auto& pLane : m_Lanes)
+		{
+			std::lock_guard laneLock{ pLane->eventsMutex };
+			pLane->events.clear();
+		}
+
+		m_CaptureStart = GetTimestamp();
+		m_IsCapturing = true;
+	}
+
+	void Profiler::EndCapture()
+	{
+		m_IsCapturing = false;
+	}
+
+	bool Profiler::WriteChromeTrace(const std::string& filename) const
+	{
+		std::ofstream file(filename);
+		if (!file)
+			return false;
+
+		std::lock_guard lock{ m_LanesMutex };
+
+		//Timestamps in the trace format are in microseconds
+		constexpr double microsecondsPerNanosecond{ 1.0 / 1000.0 };
+
+		file << std::fixed << std::setprecision(3);
+		file << "{\"traceEvents\":[\n";
+		bool isFirstEvent{ true };
+		auto separate = [&]()
+		{
+			if (!isFirstEvent) file << ",\n";
+			isFirstEvent = false;
+		};
+
+		for (const auto& pLane : m_Lanes)
+		{
+			separate();
+			file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << pLane->threadIndex
+				<< ",\"args\":{\"name\":\"" << pLane->threadName << "\"}}";
+
+			std::lock_guard laneLock{ pLane->eventsMutex };
+			for (const Event& event : pLane->events)
+			{
+				if (event.start < m_CaptureStart) continue;
+
+				separate();
+				file << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << pLane->threadIndex
+					<< ",\"ts\":" << (event.start - m_CaptureStart) * microsecondsPerNanosecond
+					<< ",\"dur\":" << event.duration * microsecondsPerNanosecond << "}";
+			}
+		}
+
+		file << "\n]}\n";
+		return bool(file);
+	}
+
+	void Profiler::SetThreadName(const std::string& name)
+	{
+		Lane& lane{ GetThreadLane() };
+
+		std::lock_guard lock{ m_LanesMutex };
+		lane.threadName = name;
+	}
+
+	void Profiler::AddEvent(const char* name, uint64_t startNanoseconds, uint64_t endNanoseconds)
+	{
+		if (!m_IsCapturing) return;
+
+		Lane& lane{ GetThreadLane() };
+
+		std::lock_guard lock{ lane.eventsMutex };
+		lane.events.push_back({ name, startNanoseconds, endNanoseconds - startNanoseconds });
+	}
+
+	Profiler::Lane& Profiler::GetThreadLane()
+	{
+		thread_local Lane* pThreadLane{ nullptr };
+		if (pThreadLane)
+			return *pThreadLane;
+
+		std::lock_guard lock{ m_LanesMutex };
+
+		auto pLane = std::make_unique<Lane>();
+		pLane->threadIndex = int(m_Lanes.size());
+		pLane->threadName = "Thread " + std::to_string(pLane->threadIndex);
+		pThreadLane = pLane.get();
+		m_Lanes.push_back(std::move(pLane));
+
+		return *pThreadLane;
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//Profiling is always compiled into debug builds, define ENABLE_PROFILING to get it in release builds too
+#if defined(_DEBUG) && !defined(ENABLE_PROFILING)
+#define ENABLE_PROFILING
+#endif
+
+namespace dae
+{
+	//Collects timed scopes per thread and writes them out as a chrome://tracing / Perfetto JSON file
+	class Profiler final
+	{
+	public:
+		static Profiler& GetInstance();
+
+		Profiler(const Profiler&) = delete;
+		Profiler(Profiler&&) noexcept = delete;
+		Profiler& operator=(const Profiler&) = delete;
+		Profiler& operator=(Profiler&&) noexcept = delete;
+
+		void BeginCapture();
+		void EndCapture();
+		bool IsCapturing() const { return m_IsCapturing; }
+
+		bool WriteChromeTrace(const std::string& filename) const;
+
+		//Names the lane of the calling thread in the trace
+		void SetThreadName(const std::string& name);
+		void AddEvent(const char* name, uint64_t startNanoseconds, uint64_t endNanoseconds);
+
+		static uint64_t GetTimestamp()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+	private:
+		Profiler() = default;
+
+		struct Event
+		{
+			const char* name{};
+			uint64_t start{};
+			uint64_t duration{};
+		};
+
+		//Every thread writes to its own lane, so its lock is only contended while a capture starts or gets written out
+		struct Lane
+		{
+			int threadIndex{};
+			std::string threadName{};
+			std::mutex eventsMutex{};
+			std::vector<Event> events{};
+		};
+		Lane& GetThreadLane();
+
+		mutable std::mutex m_LanesMutex{};
+		std::vector<std::unique_ptr<Lane>> m_Lanes{};
+		uint64_t m_CaptureStart{};
+		std::atomic<bool> m_IsCapturing{ false };
+	};
+
+	class ScopedTimer final
+	{
+	public:
+		ScopedTimer(const char* name) :
+			m_Name{ name },
+			m_Start{ Profiler::GetInstance().IsCapturing() ? Profiler::GetTimestamp() : 0 }
+		{
+		}
+		~ScopedTimer() { End(); }
+
+		ScopedTimer(const ScopedTimer&) = delete;
+		ScopedTimer(ScopedTimer&&) noexcept = delete;
+		ScopedTimer& operator=(const ScopedTimer&) = delete;
+		ScopedTimer& operator=(ScopedTimer&&) noexcept = delete;
+
+		//Ends the measurement before the scope does
+		void End()
+		{
+			if (!m_Start) return;
+
+			Profiler::GetInstance().AddEvent(m_Name, m_Start, Profiler::GetTimestamp());
+			m_Start = 0;
+		}
+
+	private:
+		const char* m_Name{};
+		uint64_t m_Start{};
+	};
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef ENABLE_PROFILING
+#define PROFILE_SCOPE(name) dae::ScopedTimer PROFILE_CONCAT(scopedTimer, __LINE__){ name }
+#define PROFILE_BEGIN(timer, name) dae::ScopedTimer timer{ name }
+#define PROFILE_END(timer) timer.End()
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_BEGIN(timer, name)
+#define PROFILE_END(timer)
+#endif
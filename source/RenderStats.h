@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+
+namespace dae
+{
+	//The parts of a frame that get timed separately
+	enum class RenderStage
+	{
+		occlusion,
+		vertex,
+		setup,
+		raster,
+		shade,
+		present,
+
+		count
+	};
+
+	inline const char* GetRenderStageName(RenderStage stage)
+	{
+		switch (stage)
+		{
+		case RenderStage::occlusion: return "occlusion";
+		case RenderStage::vertex: return "vertex";
+		case RenderStage::setup: return "setup";
+		case RenderStage::raster: return "raster";
+		case RenderStage::shade: return "shade";
+		case RenderStage::present: return "present";
+		default: return "unknown";
+		}
+	}
+
+	struct StageTimings
+	{
+		float milliseconds[int(RenderStage::count)]{};
+
+		float& operator[](RenderStage stage) { return milliseconds[int(stage)]; }
+		float operator[](RenderStage stage) const { return milliseconds[int(stage)]; }
+	};
+
+	//Counted per thread while rendering and merged once the frame is done
+	struct alignas(64) PipelineStatistics
+	{
+		uint64_t meshesCulled{};
+		uint64_t occlusionCulled{};
+		uint64_t meshletsCulled{};
+		uint64_t verticesTransformed{};
+		uint64_t trianglesSubmitted{};
+		uint64_t degenerateCulled{};
+		uint64_t backFaceCulled{};
+		uint64_t frustumCulled{};
+		uint64_t pixelsTested{};
+		uint64_t pixelsDepthPassed{};
+		uint64_t pixelsShaded{};
+
+		PipelineStatistics& operator+=(const PipelineStatistics& other)
+		{
+			meshesCulled += other.meshesCulled;
+			occlusionCulled += other.occlusionCulled;
+			meshletsCulled += other.meshletsCulled;
+			verticesTransformed += other.verticesTransformed;
+			trianglesSubmitted += other.trianglesSubmitted;
+			degenerateCulled += other.degenerateCulled;
+			backFaceCulled += other.backFaceCulled;
+			frustumCulled += other.frustumCulled;
+			pixelsTested += other.pixelsTested;
+			pixelsDepthPassed += other.pixelsDepthPassed;
+			pixelsShaded += other.pixelsShaded;
+
+			return *this;
+		}
+	};
+}
@@ -0,0 +1,118 @@
+#include "RenderTarget.h"
+
+#include <cstring>
+
+#include "SDL.h"
+#include "SDL_surface.h"
+
+namespace dae
+{
+	namespace
+	{
+		//Surfaces with the same layout are copied row by row, SDL's blit only runs when there's something to convert
+		void CopySurface(SDL_Surface* pSource, SDL_Surface* pDestination)
+		{
+			const SDL_PixelFormat* pSourceFormat{ pSource->format };
+			const SDL_PixelFormat* pDestinationFormat{ pDestination->format };
+
+			const bool isSameLayout{ pSourceFormat->BytesPerPixel == pDestinationFormat->BytesPerPixel &&
+				pSourceFormat->Rmask == pDestinationFormat->Rmask && pSourceFormat->Gmask == pDestinationFormat->Gmask &&
+				pSourceFormat->Bmask == pDestinationFormat->Bmask && pSourceFormat->Amask == pDestinationFormat->Amask &&
+				pSource->w == pDestination->w && pSource->h == pDestination->h };
+
+			if (!isSameLayout || SDL_MUSTLOCK(pDestination))
+			{
+				SDL_BlitSurface(pSource, 0, pDestination, 0);
+				return;
+			}
+
+			const size_t rowSize{ size_t(pSource->w) * pSourceFormat->BytesPerPixel };
+			const uint8_t* pSourceRow{ static_cast<const uint8_t*>(pSource->pixels) };
+			uint8_t* pDestinationRow{ static_cast<uint8_t*>(pDestination->pixels) };
+
+			if (pSource->pitch == pDestination->pitch)
+			{
+				std::memcpy(pDestinationRow, pSourceRow, size_t(pSource->pitch) * pSource->h);
+				return;
+			}
+
+			for (int y{ 0 }; y < pSource->h; ++y)
+			{
+				std::memcpy(pDestinationRow, pSourceRow, rowSize);
+				pSourceRow += pSource->pitch;
+				pDestinationRow += pDestination->pitch;
+			}
+		}
+	}
+
+	RenderTarget::RenderTarget(int width, int height) :
+		m_Width{ width },
+		m_Height{ height }
+	{
+	}
+
+	WindowRenderTarget::WindowRenderTarget(SDL_Window* pWindow) :
+		RenderTarget{ 0, 0 },
+		m_pWindow{ pWindow }
+	{
+		SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
+		m_pFrontBuffer = SDL_GetWindowSurface(pWindow);
+	}
+
+	void WindowRenderTarget::Present(SDL_Surface* pBackBuffer)
+	{
+		if (pBackBuffer != m_pFrontBuffer)
+			CopySurface(pBackBuffer, m_pFrontBuffer);
+
+		SDL_UpdateWindowSurface(m_pWindow);
+	}
+
+	SDL_Surface* WindowRenderTarget::GetDrawableSurface()
+	{
+		//The renderer writes 32 bit pixels one row right after the other and never locks while the workers draw
+		if (!m_pFrontBuffer || m_pFrontBuffer->format->BytesPerPixel != 4 || m_pFrontBuffer->pitch != m_Width * 4 || SDL_MUSTLOCK(m_pFrontBuffer))
+			return nullptr;
+
+		return m_pFrontBuffer;
+	}
+
+	const SDL_PixelFormat* WindowRenderTarget::GetPixelFormat() const
+	{
+		return m_pFrontBuffer ? m_pFrontBuffer->format : nullptr;
+	}
+
+	MemoryRenderTarget::MemoryRenderTarget(int width, int height) :
+		RenderTarget{ width, height }
+	{
+		m_pSurface = SDL_CreateRGBSurface(0, m_Width, m_Height, 32, 0, 0, 0, 0);
+	}
+
+	MemoryRenderTarget::~MemoryRenderTarget()
+	{
+		if (m_pSurface)
+		{
+			SDL_FreeSurface(m_pSurface);
+			m_pSurface = nullptr;
+		}
+	}
+
+	void MemoryRenderTarget::Present(SDL_Surface* pBackBuffer)
+	{
+		CopySurface(pBackBuffer, m_pSurface);
+	}
+
+	const SDL_PixelFormat* MemoryRenderTarget::GetPixelFormat() const
+	{
+		return m_pSurface->format;
+	}
+
+	const uint32_t* MemoryRenderTarget::GetPixels() const
+	{
+		return static_cast<const uint32_t*>(m_pSurface->pixels);
+	}
+
+	bool MemoryRenderTarget::SaveToFile(const std::string& path) const
+	{
+		return SDL_SaveBMP(m_pSurface, path.c_str()) == 0;
+	}
+}
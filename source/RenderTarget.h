@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+struct SDL_Window;
+struct SDL_Surface;
+struct SDL_PixelFormat;
+
+namespace dae
+{
+	//Where the renderer's finished back buffer ends up, either a window or a plain memory buffer
+	class RenderTarget
+	{
+	public:
+		RenderTarget(int width, int height);
+		virtual ~RenderTarget() = default;
+
+		RenderTarget(const RenderTarget&) = delete;
+		RenderTarget(RenderTarget&&) noexcept = delete;
+		RenderTarget& operator=(const RenderTarget&) = delete;
+		RenderTarget& operator=(RenderTarget&&) noexcept = delete;
+
+		//Called from the thread that draws, windows may only be updated from the thread that handles their events
+		virtual void Present(SDL_Surface* pBackBuffer) = 0;
+
+		//Surface frames can be drawn in directly, presenting it doesn't copy anything. Null when every frame has to be copied over
+		virtual SDL_Surface* GetDrawableSurface() { return nullptr; }
+
+		//Back buffers in this format can be copied over as they are
+		virtual const SDL_PixelFormat* GetPixelFormat() const = 0;
+
+		int GetWidth() const { return m_Width; }
+		int GetHeight() const { return m_Height; }
+
+	protected:
+		int m_Width{};
+		int m_Height{};
+	};
+
+	class WindowRenderTarget final : public RenderTarget
+	{
+	public:
+		WindowRenderTarget(SDL_Window* pWindow);
+		~WindowRenderTarget() override = default;
+
+		WindowRenderTarget(const WindowRenderTarget&) = delete;
+		WindowRenderTarget(WindowRenderTarget&&) noexcept = delete;
+		WindowRenderTarget& operator=(const WindowRenderTarget&) = delete;
+		WindowRenderTarget& operator=(WindowRenderTarget&&) noexcept = delete;
+
+		void Present(SDL_Surface* pBackBuffer) override;
+		SDL_Surface* GetDrawableSurface() override;
+		const SDL_PixelFormat* GetPixelFormat() const override;
+
+	private:
+		SDL_Window* m_pWindow{};
+		SDL_Surface* m_pFrontBuffer{ nullptr };
+	};
+
+	//Doesn't need a window or a display, used for batch rendering
+	class MemoryRenderTarget final : public RenderTarget
+	{
+	public:
+		MemoryRenderTarget(int width, int height);
+		~MemoryRenderTarget() override;
+
+		MemoryRenderTarget(const MemoryRenderTarget&) = delete;
+		MemoryRenderTarget(MemoryRenderTarget&&) noexcept = delete;
+		MemoryRenderTarget& operator=(const MemoryRenderTarget&) = delete;
+		MemoryRenderTarget& operator=(MemoryRenderTarget&&) noexcept = delete;
+
+		void Present(SDL_Surface* pBackBuffer) override;
+		const SDL_PixelFormat* GetPixelFormat() const override;
+
+		//False when the surface couldn't be created, SDL_GetError says why. Nothing else may be called then
+		bool IsValid() const { return m_pSurface != nullptr; }
+		const uint32_t* GetPixels() const;
+		bool SaveToFile(const std::string& path) const;
+
+	private:
+		SDL_Surface* m_pSurface{ nullptr };
+	};
+}
@@ -5,50 +5,178 @@
 //Project includes
 #include "Renderer.h"
 
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+#include <iterator>
+#include <new>
 #include <iostream>
 
+#include "Culling.h"
+#include "EdgeAntialiaser.h"
+#include "FrameArena.h"
+#include "JobSystem.h"
 #include "Math.h"
 #include "Matrix.h"
+#include "OcclusionBuffer.h"
+#include "Presenter.h"
+#include "ResolutionController.h"
+#include "Profiler.h"
+#include "RenderTarget.h"
+#include "Scene.h"
 #include "Texture.h"
+#include "TileBins.h"
+#include "Upscaler.h"
 #include "Utils.h"
+#include "VertexKernels.h"
 
 //#define RENDER_BB
 
 using namespace dae;
 
-Renderer::Renderer(SDL_Window* pWindow) :
-	m_pWindow(pWindow)
+namespace
 {
-	//Initialize
-	SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
+	//Rotated grid, every sample has a row and a column of its own so near horizontal and near vertical edges get 4 steps
+	constexpr float g_SampleOffsetsX[]{ -2 / 16.f, 6 / 16.f, -6 / 16.f, 2 / 16.f };
+	constexpr float g_SampleOffsetsY[]{ -6 / 16.f, -2 / 16.f, 2 / 16.f, 6 / 16.f };
+	//How far a sample can be from its pixel in x or y, a pixel that close to the triangle can have samples inside of it
+	constexpr float g_MaxSampleOffset{ 6 / 16.f };
+
+	//Light of the lit mode, shining down and away from the default camera
+	constexpr float g_LightDirection[]{ .577f, -.577f, .577f };
+	constexpr float g_LightIntensity{ 7.f };
+	constexpr float g_Ambient{ .025f };
+	//Specular power at a gloss of 1, the gloss map scales it down
+	constexpr float g_Shininess{ 25.f };
+
+	//Gloss is rounded to the closest level, in between two cosines the powers are interpolated.
+	//Every level has one cosine more than the steps so a cosine of 1 can still be interpolated
+	constexpr int g_NrGlossLevels{ 16 };
+	constexpr int g_NrCosineSteps{ 256 };
+
+	//4 directions at once, one lane each
+	struct Vector3x4
+	{
+		__m128 x;
+		__m128 y;
+		__m128 z;
+	};
+
+	__m128 Dot(const Vector3x4& v1, const Vector3x4& v2)
+	{
+		return _mm_add_ps(_mm_mul_ps(v1.x, v2.x), _mm_add_ps(_mm_mul_ps(v1.y, v2.y), _mm_mul_ps(v1.z, v2.z)));
+	}
+
+	Vector3x4 Cross(const Vector3x4& v1, const Vector3x4& v2)
+	{
+		return {
+			_mm_sub_ps(_mm_mul_ps(v1.y, v2.z), _mm_mul_ps(v1.z, v2.y)),
+			_mm_sub_ps(_mm_mul_ps(v1.z, v2.x), _mm_mul_ps(v1.x, v2.z)),
+			_mm_sub_ps(_mm_mul_ps(v1.x, v2.y), _mm_mul_ps(v1.y, v2.x)) };
+	}
+
+	//The approximate reciprocal square root is plenty for shading
+	Vector3x4 Normalize(const Vector3x4& v)
+	{
+		const __m128 invLength{ _mm_rsqrt_ps(Dot(v, v)) };
+		return { _mm_mul_ps(v.x, invLength), _mm_mul_ps(v.y, invLength), _mm_mul_ps(v.z, invLength) };
+	}
+}
+
+Renderer::Renderer(RenderTarget* pRenderTarget, JobSystem* pJobSystem, const VertexLayout& vertexLayout, DefaultModel model) :
+	m_pRenderTarget(pRenderTarget),
+	m_pJobSystem(pJobSystem)
+{
+	//Initialize, rendering starts at the output resolution
+	m_OutputWidth = pRenderTarget->GetWidth();
+	m_OutputHeight = pRenderTarget->GetHeight();
+	m_Width = m_OutputWidth;
+	m_Height = m_OutputHeight;
 
 	//Create Buffers
-	m_pFrontBuffer = SDL_GetWindowSurface(pWindow);
-	m_pBackBuffer = SDL_CreateRGBSurface(0, m_Width, m_Height, 32, 0, 0, 0, 0);
-	m_pBackBufferPixels = (uint32_t*)m_pBackBuffer->pixels;
+	m_pPresenter = new Presenter{ pRenderTarget };
+	m_pBackBuffer = m_pPresenter->GetBackBuffer();
+	m_pBackBufferPixels = static_cast<uint32_t*>(m_pBackBuffer->pixels);
+	InitializePixelLayout();
 
 	m_pDepthBufferPixels = new float[m_Width * m_Height];
+	m_pLowResolutionPixels = new uint32_t[m_Width * m_Height];
+	m_pUpscaler = new Upscaler{ m_pJobSystem };
+	m_pEdgeAntialiaser = new EdgeAntialiaser{ m_pJobSystem };
+	m_pResolutionController = new ResolutionController{};
+
+	//The depth buffer doesn't need an initial fill, every tile gets cleared on first touch
+	m_NumTilesX = (m_Width + m_TileSize - 1) / m_TileSize;
+	m_NumTilesY = (m_Height + m_TileSize - 1) / m_TileSize;
+	m_pTileClearedFlags = new uint8_t[m_NumTilesX * m_NumTilesY]{};
+	for (Frame& frame : m_Frames)
+	{
+		frame.pTileBins = new TileBins{ m_NumTilesX * m_NumTilesY, m_pJobSystem->GetNrThreads() };
+		frame.pArena = new FrameArena{ m_pJobSystem->GetNrThreads() };
+		frame.threadStatistics.resize(m_pJobSystem->GetNrThreads());
+		frame.threadStageCounts.resize(m_pJobSystem->GetNrThreads());
+	}
 
-	//Initialize all values to FLT_MAX
-	for (int i{0}; i < (m_Width * m_Height); ++i)
-		m_pDepthBufferPixels[i] = FLT_MAX;
+	m_pOverdrawPixels = new uint8_t[m_Width * m_Height]{};
+	InitializeSpecularPowers();
 
 	m_AspectRatio = float(m_Width) / float(m_Height);
 
-	//Initialize Camera
-	m_Camera.Initialize(60.f, { .0f,5.f,-30.f }, m_AspectRatio);
+	//Initialize Camera, the vehicle is a lot bigger than the tuktuk
+	m_Camera.Initialize(60.f, { .0f,5.f,model == DefaultModel::vehicle ? -50.f : -30.f }, m_AspectRatio);
 
-	m_pTexture = Texture::LoadFromFile("Resources/tuktuk.png");
+	//The default scene is a single tuktuk, or the vehicle with its material maps when that's asked for. More instances can be added through GetScene
+	m_pScene = new Scene{ m_pJobSystem };
+	if (model == DefaultModel::vehicle)
+	{
+		const int meshIndex{ m_pScene->AddMesh("Resources/vehicle.obj", vertexLayout) };
+		const int textureIndex{ m_pScene->AddTexture("Resources/vehicle_diffuse.png") };
+		if (meshIndex >= 0)
+		{
+			const int instanceIndex{ m_pScene->AddInstance(meshIndex, textureIndex) };
+			m_pScene->SetMaterialMaps(instanceIndex, m_pScene->AddTexture("Resources/vehicle_normal.png"),
+				m_pScene->AddTexture("Resources/vehicle_specular.png"), m_pScene->AddTexture("Resources/vehicle_gloss.png"));
+		}
+	}
+	else
+	{
+		const int meshIndex{ m_pScene->AddMesh("Resources/tuktuk.obj", vertexLayout) };
+		const int textureIndex{ m_pScene->AddTexture("Resources/tuktuk.png") };
+		if (meshIndex >= 0)
+			m_pScene->AddInstance(meshIndex, textureIndex);
+	}
 
-	Utils::ParseOBJ("Resources/tuktuk.obj", m_Mesh.vertices, m_Mesh.indices);
-	m_Mesh.primitiveTopology = PrimitiveTopology::TriangleList;
+	m_pOcclusionBuffer = new OcclusionBuffer{};
 }
 
 Renderer::~Renderer()
 {
 
 	delete[] m_pDepthBufferPixels;
-	delete m_pTexture;
+	delete[] m_pLowResolutionPixels;
+	delete m_pUpscaler;
+	delete m_pEdgeAntialiaser;
+	delete[] m_pAntialiasedPixels;
+	delete m_pResolutionController;
+	delete[] m_pTileClearedFlags;
+	delete[] m_pOverdrawPixels;
+	delete[] m_pSpecularPowers;
+	delete[] m_pSampleDepths;
+	delete[] m_pSampleColors;
+	delete[] m_pSampleFlags;
+	delete m_pScene;
+	delete m_pOcclusionBuffer;
+
+	for (Frame& frame : m_Frames)
+	{
+		delete frame.pTileBins;
+		delete frame.pArena;
+	}
+
+	//Presents whatever is still queued before the buffers go away
+	delete m_pPresenter;
 }
 
 void Renderer::Update(Timer* pTimer)
@@ -56,206 +184,1162 @@ void Renderer::Update(Timer* pTimer)
 	m_Camera.Update(pTimer);
 }
 
+void Renderer::SetCameraTransform(const Vector3& origin, const Vector3& forward)
+{
+	m_Camera.SetTransform(origin, forward);
+}
+
+int Renderer::Pick(int x, int y, float& distance)
+{
+	//Same mapping as the projection: the center of the pixel on the plane one unit in front of the camera
+	const float viewX{ (2.f * (x + 0.5f) / m_OutputWidth - 1.f) * m_AspectRatio * m_Camera.fov };
+	const float viewY{ (1.f - 2.f * (y + 0.5f) / m_OutputHeight) * m_Camera.fov };
+
+	const Ray ray{ m_Camera.origin, m_Camera.invViewMatrix.TransformVector(viewX, viewY, 1.f).Normalized() };
+	return m_pScene->Raycast(ray, distance);
+}
+
 void Renderer::Render()
 {
+	PROFILE_SCOPE("Render");
+
+	const uint64_t frameStart{ SDL_GetPerformanceCounter() };
+
+	UpdateRenderResolution();
+
+	//The frame prepared last is always the one before the next, whether it's been drawn already or not
+	Frame& lastFrame{ m_Frames[1 - m_NextFrame] };
+	Frame& nextFrame{ m_Frames[m_NextFrame] };
+
+	const bool isGeometryDirty{ !m_SkipUnchangedFrames || m_IsGeometryDirty ||
+		m_Camera.version != m_PreparedCameraVersion || m_pScene->GetVersion() != m_PreparedSceneVersion };
+	m_WasFrameSkipped = false;
+
+	if (!isGeometryDirty)
+	{
+		//Nothing moved, the bins of the last frame still hold what the camera sees
+		if (lastFrame.isPending || m_IsImageDirty)
+			DrawFrame(lastFrame);
+		else
+			m_WasFrameSkipped = true;
+	}
+	else if (!m_IsPipeliningEnabled)
+	{
+		PrepareFrame(nextFrame);
+		DrawFrame(nextFrame);
+		m_NextFrame = 1 - m_NextFrame;
+	}
+	else
+	{
+		//The frames don't share anything the stages write to, so the workers that run out of tiles can pick up the vertex stage of the next one
+		JobCounter geometry{};
+		m_pJobSystem->Run([this, &nextFrame]() { PrepareFrame(nextFrame); }, &geometry);
+
+		if (lastFrame.isPending)
+			DrawFrame(lastFrame);
+
+		m_pJobSystem->Wait(geometry);
+		nextFrame.isPending = true;
+		m_NextFrame = 1 - m_NextFrame;
+	}
+
+	if (isGeometryDirty)
+	{
+		m_PreparedCameraVersion = m_Camera.version;
+		m_PreparedSceneVersion = m_pScene->GetVersion();
+		m_IsGeometryDirty = false;
+
+		//Only frames that did the whole pipeline say anything about what the resolution costs
+		m_pResolutionController->AddFrameTime((SDL_GetPerformanceCounter() - frameStart) * 1000.f / static_cast<float>(SDL_GetPerformanceFrequency()));
+	}
+}
+
+void Renderer::Flush()
+{
+	Frame& pendingFrame{ m_Frames[1 - m_NextFrame] };
+	if (pendingFrame.isPending)
+		DrawFrame(pendingFrame);
+}
+
+void Renderer::SetFrameTimeBudget(float milliseconds)
+{
+	m_pResolutionController->SetBudget(milliseconds);
+}
+
+void Renderer::SetResolutionScaleRange(float minScale, float maxScale)
+{
+	m_pResolutionController->SetScaleRange(minScale, maxScale);
+}
+
+float Renderer::GetResolutionScale() const
+{
+	return float(m_Width) / float(m_OutputWidth);
+}
+
+void Renderer::SetMultisampling(bool isEnabled)
+{
+	if (isEnabled == m_IsMultisampling)
+		return;
+
+	//The frame that's waiting has to be drawn the way it was asked for
+	Flush();
+
+	//Big enough for the output resolution, rendering at a lower one only uses the start
+	if (isEnabled && !m_pSampleDepths)
+	{
+		const size_t nrPixels{ size_t(m_OutputWidth) * m_OutputHeight };
+		m_pSampleDepths = new float[nrPixels * m_NrSamples];
+		m_pSampleColors = new uint32_t[nrPixels * m_NrSamples];
+		m_pSampleFlags = new uint8_t[nrPixels]{};
+	}
+
+	m_IsMultisampling = isEnabled;
+	m_IsImageDirty = true;
+}
+
+void Renderer::SetEdgeAntialiasing(bool isEnabled)
+{
+	//Only needed with a lower render resolution, but that can change any frame
+	if (isEnabled && !m_pAntialiasedPixels)
+		m_pAntialiasedPixels = new uint32_t[size_t(m_OutputWidth) * m_OutputHeight];
+
+	m_IsEdgeAntialiasing = isEnabled;
+	m_IsImageDirty = true;
+}
+
+void Renderer::SetFramePipelining(bool isEnabled)
+{
+	if (!isEnabled)
+		Flush();
+
+	m_IsPipeliningEnabled = isEnabled;
+}
+
+void Renderer::PrepareFrame(Frame& frame)
+{
+	PROFILE_SCOPE("PrepareFrame");
+
+	frame.pArena->Reset();
+	std::fill(frame.threadStatistics.begin(), frame.threadStatistics.end(), PipelineStatistics{});
+	std::fill(frame.threadStageCounts.begin(), frame.threadStageCounts.end(), StageCounts{});
+	PipelineStatistics& statistics{ frame.threadStatistics[JobSystem::GetThreadIndex()] };
+	frame.cameraOrigin = m_Camera.origin;
+
+	// Define Triangles - Vertices in NDC space
+	// Every instance that's left becomes a draw call with its own vertex output, the shared geometry of the meshes isn't copied
+	const std::vector<Mesh>& meshes{ m_pScene->GetMeshes() };
+	const std::vector<MeshInstance>& instances{ m_pScene->GetInstances() };
+
+	//The hierarchy throws out everything that's off screen before any instance gets looked at
+	{
+		PROFILE_SCOPE("CullInstances");
+		const Frustum worldFrustum{ Frustum::FromMatrix(m_Camera.viewMatrix * m_Camera.projectionMatrix) };
+		m_pScene->CullInstances(worldFrustum, m_VisibleInstances);
+		statistics.meshesCulled += instances.size() - m_VisibleInstances.size();
+	}
+
+	if (m_IsOcclusionCullingEnabled)
+		CullOccludedInstances(frame, statistics);
+
+	uint64_t stageStart{ StartStage() };
+
+	//Room for every visible instance, the ones the frustum throws out just leave a gap at the end
+	frame.pDrawCalls = frame.pArena->Allocate<DrawCall>(m_VisibleInstances.size());
+	frame.nrDrawCalls = 0;
+	for (int instanceIndex : m_VisibleInstances)
+	{
+		const MeshInstance& instance{ instances[instanceIndex] };
+		const Mesh& mesh{ meshes[SelectLod(instance)] };
+
+		//The planes end up in object space, so the bounds from loading can be tested as they are
+		const Matrix worldViewProjectionMatrix = instance.worldMatrix * m_Camera.viewMatrix * m_Camera.projectionMatrix;
+		const Frustum frustum{ Frustum::FromMatrix(worldViewProjectionMatrix) };
+
+		if (frustum.IsOutside(mesh.boundingBox))
+		{
+			++statistics.meshesCulled;
+			continue;
+		}
+
+		DrawCall& drawCall{ *new(frame.pDrawCalls + frame.nrDrawCalls++) DrawCall{} };
+		drawCall.pMesh = &mesh;
+		drawCall.pTexture = m_pScene->GetTexture(instance.textureIndex);
+		drawCall.worldViewProjectionMatrix = worldViewProjectionMatrix;
+		drawCall.worldMatrix = instance.worldMatrix;
+		drawCall.pNormalMap = m_pScene->GetTexture(instance.normalMapIndex);
+		drawCall.pSpecularMap = m_pScene->GetTexture(instance.specularMapIndex);
+		drawCall.pGlossMap = m_pScene->GetTexture(instance.glossMapIndex);
+
+		CullMeshlets(drawCall, instance.worldMatrix, frustum, *frame.pArena, statistics);
+	}
+
+	//Draw calls don't share any output, each one is a job
+	m_pJobSystem->ParallelFor(frame.nrDrawCalls, 1, [this, &frame](size_t first, size_t last)
+		{
+			PipelineStatistics& threadStatistics{ frame.threadStatistics[JobSystem::GetThreadIndex()] };
+			for (size_t drawIndex{ first }; drawIndex < last; ++drawIndex)
+				VertexTransformationFunction(frame.pDrawCalls[drawIndex], *frame.pArena, threadStatistics);
+		});
+
+	EndStage(frame, RenderStage::vertex, stageStart);
+
+	BinTriangles(frame);
+
+	//Kept apart from the drawing stages, a frame that's drawn again only times the drawing anew
+	frame.preparedStageCounts = {};
+	for (const StageCounts& threadStageCounts : frame.threadStageCounts)
+		for (int stage{ 0 }; stage < int(RenderStage::count); ++stage)
+			frame.preparedStageCounts.counts[stage] += threadStageCounts.counts[stage];
+}
+
+void Renderer::DrawFrame(Frame& frame)
+{
+	PROFILE_SCOPE("DrawFrame");
+	std::fill(frame.threadStageCounts.begin(), frame.threadStageCounts.end(), StageCounts{});
+
+	//Filtering needs 32 bit pixels with 8 bits of green, other formats are drawn without it
+	const bool isUpscaled{ m_Width != m_OutputWidth || m_Height != m_OutputHeight };
+	const bool isAntialiased{ m_IsEdgeAntialiasing && m_PixelLayout.isPackable };
+	m_pColorPixels = isUpscaled || isAntialiased ? m_pLowResolutionPixels : m_pBackBufferPixels;
+
 	//@START
 	//Lock BackBuffer
 	SDL_LockSurface(m_pBackBuffer);
 
-	// Define Triangles - Vertices in NDC space
-	std::vector<Mesh> meshesWorldSpace{};
-	meshesWorldSpace.push_back(m_Mesh);
-	//{
-	//	Mesh
-	//	{
-	//		{
-	//			Vertex{{-3,3,-2},colors::White,{0,0}},
-	//			Vertex{{0,3,-2},colors::White,{.5,0}},
-	//			Vertex{{3,3,-2},colors::White,{1,0}},
-
-	//			Vertex{{-3,0,-2},colors::White,{0,0.5}},
-	//			Vertex{{0,0,-2},colors::White,{.5,.5}},
-	//			Vertex{{3,0,-2},colors::White,{1,.5}},
-
-	//			Vertex{{-3,-3,-2},colors::White,{0,1}},
-	//			Vertex{{0,-3,-2},colors::White,{.5,1}},
-	//			Vertex{{3,-3,-2},colors::White,{1,1}}
-	//		},
-
-	//	  {
-	//	  	3,0,4,1,5,2,
-	//	  	2,6,
-	//	  	6,3,7,4,8,5
-	//	  },
-	//	  PrimitiveTopology::TriangleStrip
-	//	//{
-	//	//	3,0,1,	1,4,3,	4,1,2,
-	//	//	2,5,4,	6,3,4,	4,7,6,
-	//	//	7,4,5,	5,8,7
-	//	//},
-	//	//PrimitiveTopology::TriangleList
-	//	}
-	//};
-	
-	for (Mesh& mesh : meshesWorldSpace)
-	{
-		VertexTransformationFunction(mesh);
-
-		std::vector<Vector2> verteciesRaster;
-		for (const Vertex_Out& ndcVertex : mesh.vertices_out)
-			verteciesRaster.push_back({ (ndcVertex.position.x + 1) / 2.0f * m_Width, 
-				(1.0f - ndcVertex.position.y) / 2.0f * m_Height });
-
-		//Clear depth buffer & background
-		for (int i{ 0 }; i < (m_Width * m_Height); ++i)
+	if (m_CurrentRenderingMode == RenderingModes::overdraw)
+		std::memset(m_pOverdrawPixels, 0, size_t(m_Width) * m_Height);
+
+	//A frame that's drawn again keeps the counters of its geometry, only the pixels are counted anew
+	for (PipelineStatistics& threadStatistics : frame.threadStatistics)
+	{
+		threadStatistics.pixelsTested = 0;
+		threadStatistics.pixelsDepthPassed = 0;
+		threadStatistics.pixelsShaded = 0;
+	}
+
+	//Clear depth buffer & background, the actual clearing happens per tile when it's first used
+	ResetTileClearFlags();
+
+	//Every tile only ever touches its own pixels, so they can all be rasterized at once and still draw their triangles in order
+	m_pJobSystem->ParallelFor(size_t(m_NumTilesX) * m_NumTilesY, 1, [this, &frame](size_t first, size_t last)
 		{
-			m_pDepthBufferPixels[i] = FLT_MAX;
-			m_pBackBufferPixels[i] = 0;
-		}
+			for (size_t tileIndex{ first }; tileIndex < last; ++tileIndex)
+				RasterizeTile(frame, int(tileIndex));
+		});
+
+	m_Statistics = {};
+	for (const PipelineStatistics& threadStatistics : frame.threadStatistics)
+		m_Statistics += threadStatistics;
 
-		assert(mesh.vertices_out.size() % 3 == 0);
-		//Check if the number of vertecies is divisible by 3.
-		//If not then there is an issue with our triangles
+	uint64_t stageStart{ StartStage() };
 
-		if (mesh.primitiveTopology == PrimitiveTopology::TriangleList)
-			for (int vertexIndex{0}; vertexIndex < mesh.indices.size(); vertexIndex += 3)
-				RenderTriangle(mesh, verteciesRaster, vertexIndex, false);
-		if (mesh.primitiveTopology == PrimitiveTopology::TriangleStrip)
-			for (int startVertexIndex{ 0 }; startVertexIndex < mesh.indices.size() - 2; ++startVertexIndex)
-				RenderTriangle(mesh, verteciesRaster, startVertexIndex, startVertexIndex % 2);
+	if (m_CurrentRenderingMode == RenderingModes::overdraw)
+		ResolveOverdraw();
+
+	//Everything that wasn't drawn to still has to show the background
+	ResolveUntouchedTiles();
+
+	const uint32_t* pImage{ m_pColorPixels };
+	if (isAntialiased)
+	{
+		PROFILE_SCOPE("EdgeAntialiasing");
+		uint32_t* pDestination{ isUpscaled ? m_pAntialiasedPixels : m_pBackBufferPixels };
+		m_pEdgeAntialiaser->Apply(m_pColorPixels, pDestination, m_Width, m_Height, m_PixelLayout.greenShift);
+		pImage = pDestination;
+	}
+
+	if (isUpscaled)
+	{
+		PROFILE_SCOPE("Upscale");
+		m_pUpscaler->Upscale(pImage, m_Width, m_Height, m_pBackBufferPixels, m_OutputWidth, m_OutputHeight);
 	}
 
 	//@END
 	//Update SDL Surface
 	SDL_UnlockSurface(m_pBackBuffer);
-	SDL_BlitSurface(m_pBackBuffer, 0, m_pFrontBuffer, 0);
-	SDL_UpdateWindowSurface(m_pWindow);
+	m_pPresenter->Present();
+
+	EndStage(frame, RenderStage::present, stageStart);
+
+	if (m_MeasureStageTimings)
+	{
+		const float millisecondsPerCount{ 1000.f / static_cast<float>(SDL_GetPerformanceFrequency()) };
+		for (int stage{ 0 }; stage < int(RenderStage::count); ++stage)
+		{
+			uint64_t count{ frame.preparedStageCounts.counts[stage] };
+			for (const StageCounts& threadStageCounts : frame.threadStageCounts)
+				count += threadStageCounts.counts[stage];
+			m_StageTimings.milliseconds[stage] = count * millisecondsPerCount;
+		}
+	}
+
+	frame.isPending = false;
+	m_IsImageDirty = false;
+}
+
+uint64_t Renderer::StartStage() const
+{
+	return m_MeasureStageTimings ? SDL_GetPerformanceCounter() : 0;
+}
+
+void Renderer::EndStage(Frame& frame, RenderStage stage, uint64_t& stageStart) const
+{
+	if (!m_MeasureStageTimings) return;
+
+	//The end of one stage is the start of the next one
+	const uint64_t now{ SDL_GetPerformanceCounter() };
+	frame.threadStageCounts[JobSystem::GetThreadIndex()].counts[int(stage)] += now - stageStart;
+	stageStart = now;
+}
+
+void Renderer::BinTriangles(Frame& frame) const
+{
+	PROFILE_SCOPE("BinTriangles");
+	uint64_t stageStart{ StartStage() };
+
+	//The visible meshlets in submission order, cut into batches of about the same number of triangles
+	struct MeshletReference
+	{
+		uint32_t drawIndex{};
+		uint32_t meshletIndex{};
+	};
+
+	size_t nrMeshlets{ 0 };
+	for (size_t drawIndex{ 0 }; drawIndex < frame.nrDrawCalls; ++drawIndex)
+		nrMeshlets += frame.pDrawCalls[drawIndex].visibleMeshlets.size();
+
+	MeshletReference* pMeshlets{ frame.pArena->Allocate<MeshletReference>(nrMeshlets) };
+	uint32_t* pBatchStarts{ frame.pArena->Allocate<uint32_t>(nrMeshlets + 1) };
+	int nrBatches{ 0 };
+
+	uint32_t nrMeshletsAdded{ 0 };
+	size_t nrBatchTriangles{ 0 };
+	for (uint32_t drawIndex{ 0 }; drawIndex < uint32_t(frame.nrDrawCalls); ++drawIndex)
+	{
+		const Mesh& mesh{ *frame.pDrawCalls[drawIndex].pMesh };
+
+		//Simplified meshes share their vertices between triangles, only the index count has to add up
+		assert(mesh.primitiveTopology != PrimitiveTopology::TriangleList || mesh.indices.size() % 3 == 0);
+
+		for (uint32_t meshletIndex : frame.pDrawCalls[drawIndex].visibleMeshlets)
+		{
+			if (nrBatchTriangles == 0)
+				pBatchStarts[nrBatches++] = nrMeshletsAdded;
+			pMeshlets[nrMeshletsAdded++] = { drawIndex, meshletIndex };
+
+			const uint32_t nrIndices{ mesh.meshlets[meshletIndex].nrIndices };
+			nrBatchTriangles += mesh.primitiveTopology == PrimitiveTopology::TriangleList ? nrIndices / 3 : std::max(nrIndices, 2u) - 2;
+			if (nrBatchTriangles >= m_NrTrianglesPerBinBatch)
+				nrBatchTriangles = 0;
+		}
+	}
+	pBatchStarts[nrBatches] = nrMeshletsAdded;
+
+	frame.pTileBins->Reset(nrBatches, *frame.pArena);
+
+	//Every batch only writes to the bins and to the arena of the thread running it
+	m_pJobSystem->ParallelFor(nrBatches, 1, [&](size_t first, size_t last)
+		{
+			const int threadIndex{ JobSystem::GetThreadIndex() };
+			PipelineStatistics& statistics{ frame.threadStatistics[threadIndex] };
+
+			for (int batchIndex{ int(first) }; batchIndex < int(last); ++batchIndex)
+			{
+				for (uint32_t i{ pBatchStarts[batchIndex] }; i < pBatchStarts[batchIndex + 1]; ++i)
+				{
+					const uint32_t drawIndex{ pMeshlets[i].drawIndex };
+					const Mesh& mesh{ *frame.pDrawCalls[drawIndex].pMesh };
+					const Meshlet& meshlet{ mesh.meshlets[pMeshlets[i].meshletIndex] };
+					const int lastIndex{ int(meshlet.firstIndex + meshlet.nrIndices) };
+
+					if (mesh.primitiveTopology == PrimitiveTopology::TriangleList)
+						for (int vertexIndex{ int(meshlet.firstIndex) }; vertexIndex < lastIndex; vertexIndex += 3)
+							BinTriangle(frame, threadIndex, drawIndex, vertexIndex, statistics);
+					if (mesh.primitiveTopology == PrimitiveTopology::TriangleStrip)
+						for (int startVertexIndex{ int(meshlet.firstIndex) }; startVertexIndex < lastIndex - 2; ++startVertexIndex)
+							BinTriangle(frame, threadIndex, drawIndex, startVertexIndex, statistics);
+				}
+				frame.pTileBins->EndBatch(threadIndex, batchIndex, *frame.pArena);
+			}
+		});
+
+	//Every tile only takes the lists of its own from the batches, so tiles can be gathered in parallel as well
+	frame.pTileBins->Finish(*frame.pArena);
+	m_pJobSystem->ParallelFor(frame.pTileBins->GetNrTiles(), 64, [&](size_t first, size_t last)
+		{
+			frame.pTileBins->Gather(int(first), int(last));
+		});
+
+	EndStage(frame, RenderStage::setup, stageStart);
 }
 
-void Renderer::RenderTriangle(const Mesh& mesh, const std::vector<Vector2>& verteciesRaster,
-	int vertexIndex, bool swapVertex) const
+void Renderer::BinTriangle(Frame& frame, int threadIndex, uint32_t drawIndex, int vertexIndex, PipelineStatistics& statistics) const
 {
+	const DrawCall& drawCall{ frame.pDrawCalls[drawIndex] };
+	const Mesh& mesh{ *drawCall.pMesh };
+
+	++statistics.trianglesSubmitted;
+
+	//Every other triangle of a strip has its winding flipped
+	const bool swapVertex{ mesh.primitiveTopology == PrimitiveTopology::TriangleStrip && vertexIndex % 2 };
 	const size_t vertexIndex0{ mesh.indices[vertexIndex + (2 * swapVertex)] };
 	const size_t vertexIndex1{ mesh.indices[vertexIndex + 1] };
 	const size_t vertexIndex2{ mesh.indices[vertexIndex + (!swapVertex * 2)] };
 
 	// Make sure the triangle doesn't have the same vertex twice. If it does it's got no area so we don't have to render it.
 	if (vertexIndex0 == vertexIndex1 || vertexIndex1 == vertexIndex2 || vertexIndex2 == vertexIndex0)
+	{
+		++statistics.degenerateCulled;
+		return;
+	}
+
+	const TransformedPositions& positionsOut{ drawCall.positions };
+
+	// The vertex stage already flagged every vertex that lies outside of the frustum
+	if (positionsOut.isOutsideFrustum[vertexIndex0] |
+		positionsOut.isOutsideFrustum[vertexIndex1] |
+		positionsOut.isOutsideFrustum[vertexIndex2])
+	{
+		++statistics.frustumCulled;
+		return;
+	}
+
+	const Vector2 vertex0{ positionsOut.x[vertexIndex0], positionsOut.y[vertexIndex0] };
+	const Vector2 vertex1{ positionsOut.x[vertexIndex1], positionsOut.y[vertexIndex1] };
+	const Vector2 vertex2{ positionsOut.x[vertexIndex2], positionsOut.y[vertexIndex2] };
+
+	// Back facing triangles can't cover a single pixel, zero area ones would only produce NaN weights
+	const float totalTriangleArea{ Vector2::Cross(vertex1 - vertex0,vertex2 - vertex0) };
+	if (totalTriangleArea <= 0.f)
+	{
+		++(totalTriangleArea < 0.f ? statistics.backFaceCulled : statistics.degenerateCulled);
+		return;
+	}
+
+	int minX{}, minY{}, maxX{}, maxY{};
+	GetPixelBounds(vertex0, vertex1, vertex2, minX, minY, maxX, maxY);
+	if (minX >= maxX || minY >= maxY)
 		return;
 
-	const Vector2 vertex0{ verteciesRaster[vertexIndex0] };
-	const Vector2 vertex1{ verteciesRaster[vertexIndex1] };
-	const Vector2 vertex2{ verteciesRaster[vertexIndex2] };
-
-	const Vector2 vertex0NDC = { mesh.vertices_out[vertexIndex0].position.x, mesh.vertices_out[vertexIndex0].position.y };
-	const Vector2 vertex1NDC = { mesh.vertices_out[vertexIndex1].position.x, mesh.vertices_out[vertexIndex1].position.y };
-	const Vector2 vertex2NDC = { mesh.vertices_out[vertexIndex2].position.x, mesh.vertices_out[vertexIndex2].position.y };
-	
-	if (vertex0NDC.x < -1.f || vertex0NDC.x > 1.f ||
-		vertex0NDC.y < -1.f || vertex0NDC.y > 1.f ||
-		vertex1NDC.x < -1.f || vertex1NDC.x > 1.f ||
-		vertex1NDC.y < -1.f || vertex1NDC.y > 1.f ||
-		vertex2NDC.x < -1.f || vertex2NDC.x > 1.f ||
-		vertex2NDC.y < -1.f || vertex2NDC.y > 1.f) return;
+	const int maxTileX{ (maxX - 1) / m_TileSize };
+	const int maxTileY{ (maxY - 1) / m_TileSize };
+	for (int tileY{ minY / m_TileSize }; tileY <= maxTileY; ++tileY)
+		for (int tileX{ minX / m_TileSize }; tileX <= maxTileX; ++tileX)
+			frame.pTileBins->Add(threadIndex, tileX + tileY * m_NumTilesX, { drawIndex, uint32_t(vertexIndex) }, *frame.pArena);
+}
 
+void Renderer::GetPixelBounds(const Vector2& vertex0, const Vector2& vertex1, const Vector2& vertex2, int& minX, int& minY, int& maxX, int& maxY) const
+{
 	// Define the Bounding Box
 	Vector2 bottomLeft{ Vector2::SmallestVectorComponents(vertex0,Vector2::SmallestVectorComponents(vertex1,vertex2)) };
 	Vector2 topRight{ Vector2::BiggestVectorComponents(vertex0,Vector2::BiggestVectorComponents(vertex1,vertex2)) };
 
-	// Add the margin to fix the black lines between the triangles
-	constexpr float margin{ 1.f };
-	bottomLeft -= {margin, margin};
-	topRight += {margin, margin};
+	// Every pixel whose point or one of whose samples could be inside, the last one included
+	const float reach{ m_IsMultisampling ? g_MaxSampleOffset : 0.f };
+	bottomLeft = { std::ceil(bottomLeft.x - reach), std::ceil(bottomLeft.y - reach) };
+	topRight = { std::floor(topRight.x + reach) + 1.f, std::floor(topRight.y + reach) + 1.f };
+
+	Utils::Clamp(bottomLeft.x, 0, float(m_Width));
+	Utils::Clamp(topRight.x, 0, float(m_Width));
+	Utils::Clamp(bottomLeft.y, 0, float(m_Height));
+	Utils::Clamp(topRight.y, 0, float(m_Height));
+
+	minX = int(bottomLeft.x);
+	minY = int(bottomLeft.y);
+	maxX = int(topRight.x);
+	maxY = int(topRight.y);
+}
+
+void Renderer::RasterizeTile(Frame& frame, int tileIndex)
+{
+	PROFILE_SCOPE("RasterizeTile");
+
+	if (frame.pTileBins->IsEmpty(tileIndex))
+		return;
+
+	//Tiles nothing touched are resolved to the background at the end
+	const int tileX{ tileIndex % m_NumTilesX };
+	const int tileY{ tileIndex / m_NumTilesX };
+	ClearTile(tileX, tileY);
+	m_pTileClearedFlags[tileIndex] = 1;
+
+	PipelineStatistics& statistics{ frame.threadStatistics[JobSystem::GetThreadIndex()] };
+	frame.pTileBins->ForEach(tileIndex, [&](const BinnedTriangle& triangle)
+		{
+			const DrawCall& drawCall{ frame.pDrawCalls[triangle.drawIndex] };
+			const bool swapVertex{ drawCall.pMesh->primitiveTopology == PrimitiveTopology::TriangleStrip && triangle.firstIndex % 2 };
+			RenderTriangle(frame, drawCall, int(triangle.firstIndex), swapVertex, tileX, tileY, statistics);
+		});
+
+	//Overdraw never writes colors, so no pixel has samples of its own
+	if (m_IsMultisampling && m_CurrentRenderingMode != RenderingModes::overdraw)
+		ResolveTileSamples(tileX, tileY);
+}
+
+void Renderer::RenderTriangle(Frame& frame, const DrawCall& drawCall, int vertexIndex, bool swapVertex, int tileX, int tileY, PipelineStatistics& statistics) const
+{
+	PROFILE_SCOPE("RenderTriangle");
+	PROFILE_BEGIN(setupTimer, "TriangleSetup");
+	uint64_t stageStart{ StartStage() };
+
+	const Mesh& mesh{ *drawCall.pMesh };
+	const Texture* pTexture{ drawCall.pTexture };
+
+	// Binning already threw out everything that can't cover a pixel
+	const size_t vertexIndex0{ mesh.indices[vertexIndex + (2 * swapVertex)] };
+	const size_t vertexIndex1{ mesh.indices[vertexIndex + 1] };
+	const size_t vertexIndex2{ mesh.indices[vertexIndex + (!swapVertex * 2)] };
+
+	const TransformedPositions& positionsOut{ drawCall.positions };
+
+	const Vector2 vertex0{ positionsOut.x[vertexIndex0], positionsOut.y[vertexIndex0] };
+	const Vector2 vertex1{ positionsOut.x[vertexIndex1], positionsOut.y[vertexIndex1] };
+	const Vector2 vertex2{ positionsOut.x[vertexIndex2], positionsOut.y[vertexIndex2] };
+
+	const float totalTriangleArea{ Vector2::Cross(vertex1 - vertex0,vertex2 - vertex0) };
+
+	// Only the part of the bounding box inside of this tile
+	int minX{}, minY{}, maxX{}, maxY{};
+	GetPixelBounds(vertex0, vertex1, vertex2, minX, minY, maxX, maxY);
+	minX = std::max(minX, tileX * m_TileSize);
+	minY = std::max(minY, tileY * m_TileSize);
+	maxX = std::min(maxX, (tileX + 1) * m_TileSize);
+	maxY = std::min(maxY, (tileY + 1) * m_TileSize);
+
+	// Everything that only depends on the triangle gets calculated once instead of for every pixel
+	const float invTotalTriangleArea{ 1 / totalTriangleArea };
+
+	const float invDepth0{ 1.f / positionsOut.z[vertexIndex0] };
+	const float invDepth1{ 1.f / positionsOut.z[vertexIndex1] };
+	const float invDepth2{ 1.f / positionsOut.z[vertexIndex2] };
+
+	const float invWDepth0{ positionsOut.invW[vertexIndex0] };
+	const float invWDepth1{ positionsOut.invW[vertexIndex1] };
+	const float invWDepth2{ positionsOut.invW[vertexIndex2] };
 
-	Utils::Clamp(bottomLeft.x, 0, float(m_Width) - 1);
-	Utils::Clamp(topRight.x, 0, float(m_Width) - 1);
-	Utils::Clamp(bottomLeft.y, 0, float(m_Height) - 1);
-	Utils::Clamp(topRight.y, 0, float(m_Height) - 1);
-	
-	for (int px{ int(bottomLeft.x) }; px < int(topRight.x); ++px)
+	const Vector2 vertex0UV{ positionsOut.u[vertexIndex0], positionsOut.v[vertexIndex0] };
+	const Vector2 vertex1UV{ positionsOut.u[vertexIndex1], positionsOut.v[vertexIndex1] };
+	const Vector2 vertex2UV{ positionsOut.u[vertexIndex2], positionsOut.v[vertexIndex2] };
+
+	auto remap = [](float value, float min, float max)
+	{
+		return (value - min) / (max - min);
+	};
+
+	// The weights of all 4 samples of a pixel at once, before they're divided by the area they're the edge functions
+	const __m128 sampleOffsetsX{ _mm_loadu_ps(g_SampleOffsetsX) };
+	const __m128 sampleOffsetsY{ _mm_loadu_ps(g_SampleOffsetsY) };
+	const __m128 edge0X{ _mm_set1_ps(vertex1.x - vertex2.x) }, edge0Y{ _mm_set1_ps(vertex1.y - vertex2.y) };
+	const __m128 edge1X{ _mm_set1_ps(vertex2.x - vertex0.x) }, edge1Y{ _mm_set1_ps(vertex2.y - vertex0.y) };
+	const __m128 edge2X{ _mm_set1_ps(vertex0.x - vertex1.x) }, edge2Y{ _mm_set1_ps(vertex0.y - vertex1.y) };
+	const __m128 sampleInvDepth0{ _mm_set1_ps(invDepth0 * invTotalTriangleArea) };
+	const __m128 sampleInvDepth1{ _mm_set1_ps(invDepth1 * invTotalTriangleArea) };
+	const __m128 sampleInvDepth2{ _mm_set1_ps(invDepth2 * invTotalTriangleArea) };
+
+	// Top left fill rule: a point right on an edge only belongs to the triangle when that's a top or a left edge,
+	// so pixels and samples on the edge two triangles share are drawn once instead of twice or not at all
+	auto isTopLeft = [](const Vector2& edge) { return edge.y > 0.f || (edge.y == 0.f && edge.x < 0.f); };
+	const bool isTopLeft0{ isTopLeft(vertex1 - vertex2) };
+	const bool isTopLeft1{ isTopLeft(vertex2 - vertex0) };
+	const bool isTopLeft2{ isTopLeft(vertex0 - vertex1) };
+	auto isInside = [](float edge, bool isTopLeftEdge) { return edge > 0.f || (edge == 0.f && isTopLeftEdge); };
+	auto isPointInside = [&](const Vector2& point)
+	{
+		return isInside(Vector2::Cross(point - vertex1, vertex1 - vertex2), isTopLeft0) &&
+			isInside(Vector2::Cross(point - vertex2, vertex2 - vertex0), isTopLeft1) &&
+			isInside(Vector2::Cross(point - vertex0, vertex0 - vertex1), isTopLeft2);
+	};
+
+	auto isSampleInside = [](__m128 edge, bool isTopLeftEdge)
+	{
+		const __m128 zero{ _mm_setzero_ps() };
+		return isTopLeftEdge ? _mm_cmpge_ps(edge, zero) : _mm_cmpgt_ps(edge, zero);
+	};
+
+	// A frame that was prepared before switching to the lit mode doesn't have its attributes, it's drawn with the texture only
+	const bool isLit{ m_CurrentRenderingMode == RenderingModes::lit && positionsOut.normalX };
+	LitTriangle litTriangle{};
+	if (isLit)
+		SetUpLitTriangle(positionsOut, vertexIndex0, vertexIndex1, vertexIndex2, litTriangle);
+
+	EndStage(frame, RenderStage::setup, stageStart);
+	PROFILE_END(setupTimer);
+
+	// Rows are handled in chunks, first every pixel of the chunk is rasterized, then the covered ones are shaded
+	constexpr int chunkQuads{ 16 };
+	constexpr int chunkPixels{ chunkQuads * 4 };
+
+	// Counted locally so the statistics only get touched once per triangle
+	uint64_t pixelsTested{ 0 };
+	uint64_t pixelsDepthPassed{ 0 };
+	uint64_t pixelsShaded{ 0 };
+
+	for (int py{ minY }; py < maxY; ++py)
 	{
-		for (int py{ int(bottomLeft.y)}; py < int(topRight.y); ++py)
+		for (int chunkX{ minX }; chunkX < maxX; chunkX += chunkPixels)
 		{
-			const Vector2 currentPixel{ static_cast<float>(px),static_cast<float>(py) };
-			const int pixelIdx{ px + py * m_Width };
+			const int chunkEnd{ std::min(chunkX + chunkPixels, maxX) };
+
+			Vector2 chunkUVs[chunkPixels];
+			float chunkDepths[chunkPixels];
+			// Perspective correct weights of the first two vertices, only the lit mode needs them.
+			// Quads are shaded 4 lanes at once, lanes that aren't covered read zeros instead of whatever was on the stack
+			float chunkWeights0[chunkPixels]{};
+			float chunkWeights1[chunkPixels]{};
+			int coverageMasks[chunkQuads]{};
+			uint8_t chunkSampleMasks[chunkPixels];
+			bool isChunkCovered{ false };
+
+			pixelsTested += chunkEnd - chunkX;
 
-			if (Utils::IsInTriangle(currentPixel, vertex0, vertex1, vertex2))
+			for (int px{ chunkX }; px < chunkEnd; ++px)
 			{
-				ColorRGB finalColor{};
-				float weight0 = Vector2::Cross(currentPixel - vertex1, vertex1 - vertex2);
-				float weight1 = Vector2::Cross(currentPixel - vertex2, vertex2 - vertex0);
-				float weight2 = Vector2::Cross(currentPixel - vertex0, vertex0 - vertex1);
-
-				const float totalTriangleArea{ Vector2::Cross(vertex1 - vertex0,vertex2 - vertex0) };
-				const float invTotalTriangleArea{ 1 / totalTriangleArea };
-				weight0 *= invTotalTriangleArea;
-				weight1 *= invTotalTriangleArea;
-				weight2 *= invTotalTriangleArea;
-
-				const float depth0{ (mesh.vertices_out[vertexIndex0].position.z) };
-				const float depth1{ (mesh.vertices_out[vertexIndex1].position.z) };
-				const float depth2{ (mesh.vertices_out[vertexIndex2].position.z) };
-				const float interpolatedDepth{ 1.f / 
-						(weight0 * (1.f / depth0) + 
-						weight1 * (1.f / depth1) + 
-						weight2 * (1.f / depth2)) };
-
-				if (m_pDepthBufferPixels[pixelIdx] < interpolatedDepth ||
-					interpolatedDepth < 0.f || interpolatedDepth > 1.f) continue;
-
-				m_pDepthBufferPixels[pixelIdx] = interpolatedDepth;
-
-				const float wDepth0{ mesh.vertices_out[vertexIndex0].position.w };
-				const float wDepth1{ mesh.vertices_out[vertexIndex1].position.w };
-				const float wDepth2{ mesh.vertices_out[vertexIndex2].position.w };
+				const Vector2 currentPixel{ static_cast<float>(px),static_cast<float>(py) };
+				const int pixelIdx{ px + py * m_Width };
+
+				// With multisampling the samples decide what's covered, the pixel is still only shaded once
+				Vector2 shadingPoint{ currentPixel };
+				int sampleMask{ 0 };
+				if (m_IsMultisampling)
+				{
+					const __m128 sampleX{ _mm_add_ps(_mm_set1_ps(currentPixel.x), sampleOffsetsX) };
+					const __m128 sampleY{ _mm_add_ps(_mm_set1_ps(currentPixel.y), sampleOffsetsY) };
+					const __m128 edge0{ _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(sampleX, _mm_set1_ps(vertex1.x)), edge0Y), _mm_mul_ps(_mm_sub_ps(sampleY, _mm_set1_ps(vertex1.y)), edge0X)) };
+					const __m128 edge1{ _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(sampleX, _mm_set1_ps(vertex2.x)), edge1Y), _mm_mul_ps(_mm_sub_ps(sampleY, _mm_set1_ps(vertex2.y)), edge1X)) };
+					const __m128 edge2{ _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(sampleX, _mm_set1_ps(vertex0.x)), edge2Y), _mm_mul_ps(_mm_sub_ps(sampleY, _mm_set1_ps(vertex0.y)), edge2X)) };
+
+					const __m128 zero{ _mm_setzero_ps() };
+					const __m128 isCovered{ _mm_and_ps(isSampleInside(edge0, isTopLeft0), _mm_and_ps(isSampleInside(edge1, isTopLeft1), isSampleInside(edge2, isTopLeft2))) };
+					if (!_mm_movemask_ps(isCovered)) continue;
+
+					const __m128 sampleDepths{ _mm_div_ps(_mm_set1_ps(1.f), _mm_add_ps(_mm_mul_ps(edge0, sampleInvDepth0),
+						_mm_add_ps(_mm_mul_ps(edge1, sampleInvDepth1), _mm_mul_ps(edge2, sampleInvDepth2)))) };
+
+					float* pStoredDepths{ m_pSampleDepths + size_t(pixelIdx) * m_NrSamples };
+					const __m128 storedDepths{ _mm_loadu_ps(pStoredDepths) };
+					const __m128 isPassed{ _mm_and_ps(isCovered, _mm_and_ps(_mm_cmple_ps(sampleDepths, storedDepths),
+						_mm_and_ps(_mm_cmpge_ps(sampleDepths, zero), _mm_cmple_ps(sampleDepths, _mm_set1_ps(1.f))))) };
+
+					sampleMask = _mm_movemask_ps(isPassed);
+					if (!sampleMask) continue;
+
+					_mm_storeu_ps(pStoredDepths, _mm_blendv_ps(storedDepths, sampleDepths, isPassed));
+
+					// A center outside of the triangle would give colors from outside of the texture, a visible sample is always inside
+					if (sampleMask != 0b1111 && !isPointInside(currentPixel))
+					{
+						const int sampleIdx{ std::countr_zero(unsigned(sampleMask)) };
+						shadingPoint += { g_SampleOffsetsX[sampleIdx], g_SampleOffsetsY[sampleIdx] };
+					}
+				}
+				else if (!isPointInside(currentPixel)) continue;
+
+				const float weight0{ Vector2::Cross(shadingPoint - vertex1, vertex1 - vertex2) * invTotalTriangleArea };
+				const float weight1{ Vector2::Cross(shadingPoint - vertex2, vertex2 - vertex0) * invTotalTriangleArea };
+				const float weight2{ Vector2::Cross(shadingPoint - vertex0, vertex0 - vertex1) * invTotalTriangleArea };
+
+				const float interpolatedDepth{ 1.f /
+						(weight0 * invDepth0 +
+						weight1 * invDepth1 +
+						weight2 * invDepth2) };
+
+				if (!m_IsMultisampling)
+				{
+					if (m_pDepthBufferPixels[pixelIdx] < interpolatedDepth ||
+						interpolatedDepth < 0.f || interpolatedDepth > 1.f) continue;
+
+					m_pDepthBufferPixels[pixelIdx] = interpolatedDepth;
+				}
+				++pixelsDepthPassed;
 
 				const float wInterpolated{ 1.f /
-					(weight0 * (1.f / wDepth0) +
-					weight1 * (1.f / wDepth1) +
-					weight2 * (1.f / wDepth2)) };
-
-				const Vector2 vertex0UV{ mesh.vertices_out[vertexIndex0].uv /
-										mesh.vertices_out[vertexIndex0].position.w };
-				const Vector2 vertex1UV{ mesh.vertices_out[vertexIndex1].uv /
-										mesh.vertices_out[vertexIndex1].position.w };
-				const Vector2 vertex2UV{ mesh.vertices_out[vertexIndex2].uv /
-										mesh.vertices_out[vertexIndex2].position.w };
-
-				const Vector2 UVInterpolated{ (vertex0UV * weight0 +
+					(weight0 * invWDepth0 +
+					weight1 * invWDepth1 +
+					weight2 * invWDepth2) };
+
+				const int chunkIdx{ px - chunkX };
+				chunkUVs[chunkIdx] = (vertex0UV * weight0 +
 					vertex1UV * weight1 +
-					vertex2UV * weight2) * wInterpolated };
+					vertex2UV * weight2) * wInterpolated;
+				chunkDepths[chunkIdx] = interpolatedDepth;
+				chunkSampleMasks[chunkIdx] = uint8_t(sampleMask);
+				if (isLit)
+				{
+					chunkWeights0[chunkIdx] = weight0 * invWDepth0 * wInterpolated;
+					chunkWeights1[chunkIdx] = weight1 * invWDepth1 * wInterpolated;
+				}
+
+				coverageMasks[chunkIdx / 4] |= 1 << (chunkIdx % 4);
+				isChunkCovered = true;
+			}
+
+			EndStage(frame, RenderStage::raster, stageStart);
 
-				auto remap = [](float value, float min, float max)
+			if (!isChunkCovered) continue;
+
+			// Overdraw only counts, the colors get written once the whole frame is known
+			if (m_CurrentRenderingMode == RenderingModes::overdraw)
+			{
+				for (int chunkIdx{ 0 }; chunkIdx < chunkEnd - chunkX; ++chunkIdx)
 				{
-					return (value - min) / (max - min);
-				};
-				
-				const float remappedResult = remap(interpolatedDepth, 0.985f, 1.f);
+					if (!(coverageMasks[chunkIdx / 4] & (1 << (chunkIdx % 4)))) continue;
+
+					uint8_t& overdraw{ m_pOverdrawPixels[chunkX + chunkIdx + py * m_Width] };
+					if (overdraw < UINT8_MAX) ++overdraw;
+				}
+
+				EndStage(frame, RenderStage::shade, stageStart);
+				continue;
+			}
+
+			// Pixels are shaded in groups of 4 so the whole group can be packed to the back buffer at once
+			for (int quad{ 0 }; quad < chunkQuads; ++quad)
+			{
+				const int coverageMask{ coverageMasks[quad] };
+				if (!coverageMask) continue;
 
-				switch (m_CurrentRenderingMode)
+				ColorRGB quadColors[4]{};
+				if (isLit)
+				{
+					ShadeLitQuad(frame, drawCall, litTriangle, chunkWeights0 + quad * 4, chunkWeights1 + quad * 4, chunkUVs + quad * 4, quadColors);
+					pixelsShaded += std::popcount(unsigned(coverageMask));
+				}
+				else for (int lane{ 0 }; lane < 4; ++lane)
 				{
-				case RenderingModes::texture:
-					finalColor = m_pTexture->Sample(UVInterpolated);
-					break;
-					//todo fix bounding box rendering
-				case RenderingModes::boundingBox:
-					finalColor = colors::White;
-					break;
-				case RenderingModes::depthValues:
-					finalColor = { remappedResult, remappedResult,remappedResult };
-					break;
+					if (!(coverageMask & (1 << lane))) continue;
+
+					const int chunkIdx{ quad * 4 + lane };
+					ColorRGB& finalColor{ quadColors[lane] };
+					switch (m_CurrentRenderingMode)
+					{
+					case RenderingModes::texture:
+					case RenderingModes::lit:
+						finalColor = pTexture->Sample(chunkUVs[chunkIdx]);
+						break;
+						//todo fix bounding box rendering
+					case RenderingModes::boundingBox:
+						finalColor = colors::White;
+						break;
+					case RenderingModes::depthValues:
+					{
+						const float remappedResult = remap(chunkDepths[chunkIdx], 0.985f, 1.f);
+						finalColor = { remappedResult, remappedResult,remappedResult };
+						break;
+					}
+					default:
+						break;
+					}
+					++pixelsShaded;
 				}
 
 				//Update Color in Buffer
-				finalColor.MaxToOne();
+				const int firstPixelIdx{ chunkX + quad * 4 + py * m_Width };
+				if (!m_IsMultisampling)
+				{
+					WritePixelQuad(firstPixelIdx, quadColors, coverageMask);
+					continue;
+				}
+
+				alignas(16) uint32_t packedPixels[4];
+				PackPixelQuad(quadColors, packedPixels);
+				for (int lane{ 0 }; lane < 4; ++lane)
+					if (coverageMask & (1 << lane))
+						WriteSamples(firstPixelIdx + lane, packedPixels[lane], chunkSampleMasks[quad * 4 + lane]);
+			}
+
+			EndStage(frame, RenderStage::shade, stageStart);
+		}
+	}
+
+	statistics.pixelsTested += pixelsTested;
+	statistics.pixelsDepthPassed += pixelsDepthPassed;
+	statistics.pixelsShaded += pixelsShaded;
+}
+
+void Renderer::InitializeSpecularPowers()
+{
+	m_pSpecularPowers = new float[g_NrGlossLevels * (g_NrCosineSteps + 1)];
+
+	for (int level{ 0 }; level < g_NrGlossLevels; ++level)
+	{
+		const float exponent{ g_Shininess * level / (g_NrGlossLevels - 1) };
+		for (int step{ 0 }; step <= g_NrCosineSteps; ++step)
+			m_pSpecularPowers[level * (g_NrCosineSteps + 1) + step] = std::pow(float(step) / g_NrCosineSteps, exponent);
+	}
+}
+
+void Renderer::SetUpLitTriangle(const TransformedPositions& positions, size_t vertexIndex0, size_t vertexIndex1, size_t vertexIndex2, LitTriangle& triangle) const
+{
+	const float* streams[3][3]{
+		{ positions.worldX, positions.worldY, positions.worldZ },
+		{ positions.normalX, positions.normalY, positions.normalZ },
+		{ positions.tangentX, positions.tangentY, positions.tangentZ } };
+
+	for (int attribute{ 0 }; attribute < 3; ++attribute)
+	{
+		const float* const* stream{ streams[attribute] };
+		const Vector3 attribute0{ stream[0][vertexIndex0], stream[1][vertexIndex0], stream[2][vertexIndex0] };
+		const Vector3 attribute1{ stream[0][vertexIndex1], stream[1][vertexIndex1], stream[2][vertexIndex1] };
+		const Vector3 attribute2{ stream[0][vertexIndex2], stream[1][vertexIndex2], stream[2][vertexIndex2] };
+
+		triangle.attributes[attribute] = attribute2;
+		triangle.deltas0[attribute] = attribute0 - attribute2;
+		triangle.deltas1[attribute] = attribute1 - attribute2;
+	}
+}
+
+void Renderer::ShadeLitQuad(const Frame& frame, const DrawCall& drawCall, const LitTriangle& triangle, const float weights0[4], const float weights1[4], const Vector2 uvs[4], ColorRGB colors[4]) const
+{
+	const __m128 weight0{ _mm_loadu_ps(weights0) };
+	const __m128 weight1{ _mm_loadu_ps(weights1) };
+	auto interpolate = [&](int attribute) -> Vector3x4
+	{
+		const Vector3& base{ triangle.attributes[attribute] };
+		const Vector3& delta0{ triangle.deltas0[attribute] };
+		const Vector3& delta1{ triangle.deltas1[attribute] };
+		return {
+			_mm_add_ps(_mm_set1_ps(base.x), _mm_add_ps(_mm_mul_ps(weight0, _mm_set1_ps(delta0.x)), _mm_mul_ps(weight1, _mm_set1_ps(delta1.x)))),
+			_mm_add_ps(_mm_set1_ps(base.y), _mm_add_ps(_mm_mul_ps(weight0, _mm_set1_ps(delta0.y)), _mm_mul_ps(weight1, _mm_set1_ps(delta1.y)))),
+			_mm_add_ps(_mm_set1_ps(base.z), _mm_add_ps(_mm_mul_ps(weight0, _mm_set1_ps(delta0.z)), _mm_mul_ps(weight1, _mm_set1_ps(delta1.z)))) };
+	};
+
+	const __m128 zero{ _mm_setzero_ps() };
+	const __m128 one{ _mm_set1_ps(1.f) };
+
+	const Vector3x4 normal{ Normalize(interpolate(1)) };
+	Vector3x4 shadingNormal{ normal };
+	if (drawCall.pNormalMap)
+	{
+		// Interpolating bends the tangent away from the normal, it's made perpendicular again before building the tangent space
+		const Vector3x4 interpolatedTangent{ interpolate(2) };
+		const __m128 alongNormal{ Dot(interpolatedTangent, normal) };
+		const Vector3x4 tangent{ Normalize({
+			_mm_sub_ps(interpolatedTangent.x, _mm_mul_ps(normal.x, alongNormal)),
+			_mm_sub_ps(interpolatedTangent.y, _mm_mul_ps(normal.y, alongNormal)),
+			_mm_sub_ps(interpolatedTangent.z, _mm_mul_ps(normal.z, alongNormal)) }) };
+		const Vector3x4 binormal{ Cross(normal, tangent) };
+
+		// From 0..1 in the map to -1..1
+		Vector3x4 sampled{};
+		drawCall.pNormalMap->SampleQuad(uvs, sampled.x, sampled.y, sampled.z);
+		const __m128 two{ _mm_set1_ps(2.f) };
+		sampled = { _mm_sub_ps(_mm_mul_ps(sampled.x, two), one), _mm_sub_ps(_mm_mul_ps(sampled.y, two), one), _mm_sub_ps(_mm_mul_ps(sampled.z, two), one) };
+
+		shadingNormal = Normalize({
+			_mm_add_ps(_mm_mul_ps(tangent.x, sampled.x), _mm_add_ps(_mm_mul_ps(binormal.x, sampled.y), _mm_mul_ps(normal.x, sampled.z))),
+			_mm_add_ps(_mm_mul_ps(tangent.y, sampled.x), _mm_add_ps(_mm_mul_ps(binormal.y, sampled.y), _mm_mul_ps(normal.y, sampled.z))),
+			_mm_add_ps(_mm_mul_ps(tangent.z, sampled.x), _mm_add_ps(_mm_mul_ps(binormal.z, sampled.y), _mm_mul_ps(normal.z, sampled.z))) });
+	}
+
+	const Vector3x4 toLight{ _mm_set1_ps(-g_LightDirection[0]), _mm_set1_ps(-g_LightDirection[1]), _mm_set1_ps(-g_LightDirection[2]) };
+	const __m128 lambert{ _mm_max_ps(Dot(shadingNormal, toLight), zero) };
+
+	Vector3x4 diffuse{};
+	drawCall.pTexture->SampleQuad(uvs, diffuse.x, diffuse.y, diffuse.z);
+
+	// Without a specular map there's no highlight at all
+	Vector3x4 specular{ zero, zero, zero };
+	if (drawCall.pSpecularMap)
+	{
+		const Vector3x4 position{ interpolate(0) };
+		const Vector3x4 toCamera{ Normalize({
+			_mm_sub_ps(_mm_set1_ps(frame.cameraOrigin.x), position.x),
+			_mm_sub_ps(_mm_set1_ps(frame.cameraOrigin.y), position.y),
+			_mm_sub_ps(_mm_set1_ps(frame.cameraOrigin.z), position.z) }) };
+		const Vector3x4 halfVector{ Normalize({ _mm_add_ps(toLight.x, toCamera.x), _mm_add_ps(toLight.y, toCamera.y), _mm_add_ps(toLight.z, toCamera.z) }) };
+		const __m128 cosine{ _mm_min_ps(_mm_max_ps(Dot(shadingNormal, halfVector), zero), one) };
+
+		__m128 gloss{ one };
+		if (drawCall.pGlossMap)
+		{
+			__m128 unusedGreen{}, unusedBlue{};
+			drawCall.pGlossMap->SampleQuad(uvs, gloss, unusedGreen, unusedBlue);
+		}
+
+		// Closest gloss level, the last step is never the lower one so its neighbour is still in the row
+		const __m128 step{ _mm_mul_ps(cosine, _mm_set1_ps(float(g_NrCosineSteps))) };
+		const __m128i lowerStep{ _mm_min_epi32(_mm_cvttps_epi32(step), _mm_set1_epi32(g_NrCosineSteps - 1)) };
+		const __m128 fraction{ _mm_sub_ps(step, _mm_cvtepi32_ps(lowerStep)) };
+		const __m128i level{ _mm_cvtps_epi32(_mm_mul_ps(gloss, _mm_set1_ps(float(g_NrGlossLevels - 1)))) };
+
+		alignas(16) int indices[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(indices), _mm_add_epi32(_mm_mullo_epi32(level, _mm_set1_epi32(g_NrCosineSteps + 1)), lowerStep));
+
+		const float* pPowers{ m_pSpecularPowers };
+		const __m128 lower{ _mm_setr_ps(pPowers[indices[0]], pPowers[indices[1]], pPowers[indices[2]], pPowers[indices[3]]) };
+		const __m128 upper{ _mm_setr_ps(pPowers[indices[0] + 1], pPowers[indices[1] + 1], pPowers[indices[2] + 1], pPowers[indices[3] + 1]) };
+		const __m128 power{ _mm_add_ps(lower, _mm_mul_ps(_mm_sub_ps(upper, lower), fraction)) };
+
+		drawCall.pSpecularMap->SampleQuad(uvs, specular.x, specular.y, specular.z);
+		specular = { _mm_mul_ps(specular.x, power), _mm_mul_ps(specular.y, power), _mm_mul_ps(specular.z, power) };
+	}
+
+	// Lambert diffuse plus the highlight, both scaled by how much light falls on the surface
+	const __m128 diffuseScale{ _mm_set1_ps(g_LightIntensity / PI) };
+	const __m128 ambient{ _mm_set1_ps(g_Ambient) };
+	alignas(16) float red[4], green[4], blue[4];
+	_mm_store_ps(red, _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(diffuse.x, diffuseScale), specular.x), lambert), ambient));
+	_mm_store_ps(green, _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(diffuse.y, diffuseScale), specular.y), lambert), ambient));
+	_mm_store_ps(blue, _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(diffuse.z, diffuseScale), specular.z), lambert), ambient));
+
+	for (int lane{ 0 }; lane < 4; ++lane)
+		colors[lane] = { red[lane], green[lane], blue[lane] };
+}
+
+void Renderer::ResolveOverdraw() const
+{
+	PROFILE_SCOPE("ResolveOverdraw");
+
+	// Black means never drawn, drawn once is blue, then green -> yellow -> red the more often a pixel got drawn
+	const ColorRGB heatColors[]{ colors::Black, colors::Blue, colors::Green, colors::Yellow, colors::Red };
+	constexpr int maxHeatColorIdx{ int(std::size(heatColors)) - 1 };
+	constexpr float overdrawPerColor{ 2.f };
+
+	for (int py{ 0 }; py < m_Height; ++py)
+	{
+		for (int quadX{ 0 }; quadX < m_Width; quadX += 4)
+		{
+			ColorRGB quadColors[4]{};
+			int coverageMask{ 0 };
+
+			for (int lane{ 0 }; lane < 4 && quadX + lane < m_Width; ++lane)
+			{
+				const uint8_t overdraw{ m_pOverdrawPixels[quadX + lane + py * m_Width] };
+				if (!overdraw) continue;
+
+				const float heat{ std::min(1.f + (overdraw - 1) / overdrawPerColor, float(maxHeatColorIdx)) };
+				const int colorIdx{ std::min(int(heat), maxHeatColorIdx - 1) };
+				quadColors[lane] = ColorRGB::Lerp(heatColors[colorIdx], heatColors[colorIdx + 1], heat - colorIdx);
+				coverageMask |= 1 << lane;
+			}
+
+			if (coverageMask)
+				WritePixelQuad(quadX + py * m_Width, quadColors, coverageMask);
+		}
+	}
+}
+
+void Renderer::InitializePixelLayout()
+{
+	const SDL_PixelFormat* pFormat{ m_pPresenter->GetPixelFormat() };
+
+	// Only 8 bits per channel formats can be packed with shifts, anything else goes through SDL_MapRGB
+	m_PixelLayout.isPackable = pFormat->BytesPerPixel == 4 &&
+		pFormat->Rloss == 0 && pFormat->Gloss == 0 && pFormat->Bloss == 0;
+
+	m_PixelLayout.redShift = pFormat->Rshift;
+	m_PixelLayout.greenShift = pFormat->Gshift;
+	m_PixelLayout.blueShift = pFormat->Bshift;
+	m_PixelLayout.alphaMask = pFormat->Amask;
+}
+
+void Renderer::PackPixelQuad(const ColorRGB colors[4], uint32_t packedPixels[4]) const
+{
+	if (!m_PixelLayout.isPackable)
+	{
+		for (int lane{ 0 }; lane < 4; ++lane)
+		{
+			ColorRGB finalColor{ colors[lane] };
+			finalColor.MaxToOne();
+
+			packedPixels[lane] = SDL_MapRGB(m_pBackBuffer->format,
+				static_cast<uint8_t>(finalColor.r * 255),
+				static_cast<uint8_t>(finalColor.g * 255),
+				static_cast<uint8_t>(finalColor.b * 255));
+		}
+		return;
+	}
+
+	// Transpose to one register per channel
+	__m128 red{ _mm_setr_ps(colors[0].r, colors[1].r, colors[2].r, colors[3].r) };
+	__m128 green{ _mm_setr_ps(colors[0].g, colors[1].g, colors[2].g, colors[3].g) };
+	__m128 blue{ _mm_setr_ps(colors[0].b, colors[1].b, colors[2].b, colors[3].b) };
+
+	// Same as ColorRGB::MaxToOne, dividing by 1 leaves colors that are already in range untouched
+	const __m128 one{ _mm_set1_ps(1.f) };
+	const __m128 maxValue{ _mm_max_ps(one, _mm_max_ps(red, _mm_max_ps(green, blue))) };
+	const __m128 scale{ _mm_div_ps(_mm_set1_ps(255.f), maxValue) };
+	const __m128 zero{ _mm_setzero_ps() };
+
+	// Truncate like the static_cast<uint8_t> used to
+	const __m128i redInt{ _mm_cvttps_epi32(_mm_max_ps(zero, _mm_mul_ps(red, scale))) };
+	const __m128i greenInt{ _mm_cvttps_epi32(_mm_max_ps(zero, _mm_mul_ps(green, scale))) };
+	const __m128i blueInt{ _mm_cvttps_epi32(_mm_max_ps(zero, _mm_mul_ps(blue, scale))) };
+
+	__m128i packed{ _mm_set1_epi32(static_cast<int>(m_PixelLayout.alphaMask)) };
+	packed = _mm_or_si128(packed, _mm_sll_epi32(redInt, _mm_cvtsi32_si128(m_PixelLayout.redShift)));
+	packed = _mm_or_si128(packed, _mm_sll_epi32(greenInt, _mm_cvtsi32_si128(m_PixelLayout.greenShift)));
+	packed = _mm_or_si128(packed, _mm_sll_epi32(blueInt, _mm_cvtsi32_si128(m_PixelLayout.blueShift)));
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(packedPixels), packed);
+}
+
+void Renderer::WritePixelQuad(int firstPixelIdx, const ColorRGB colors[4], int coverageMask) const
+{
+	uint32_t* pDestination{ m_pColorPixels + firstPixelIdx };
+
+	alignas(16) uint32_t packedPixels[4];
+	PackPixelQuad(colors, packedPixels);
+
+	if (coverageMask == 0b1111)
+	{
+		std::memcpy(pDestination, packedPixels, sizeof(packedPixels));
+		return;
+	}
+
+	// Partially covered groups only write their own pixels, the rest might belong to another triangle or lie outside the row
+	for (int lane{ 0 }; lane < 4; ++lane)
+		if (coverageMask & (1 << lane))
+			pDestination[lane] = packedPixels[lane];
+}
+
+void Renderer::WriteSamples(int pixelIdx, uint32_t color, int sampleMask) const
+{
+	uint32_t* pSamples{ m_pSampleColors + size_t(pixelIdx) * m_NrSamples };
+	uint8_t& flag{ m_pSampleFlags[pixelIdx] };
+
+	if (sampleMask == 0b1111)
+	{
+		m_pColorPixels[pixelIdx] = color;
+		flag = 0;
+		return;
+	}
+
+	// First triangle that only covers part of the pixel, the samples start out as the color it had until now
+	if (!flag)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pSamples), _mm_set1_epi32(static_cast<int>(m_pColorPixels[pixelIdx])));
+		flag = 0xFF;
+	}
+
+	for (int sample{ 0 }; sample < m_NrSamples; ++sample)
+		if (sampleMask & (1 << sample))
+			pSamples[sample] = color;
+}
+
+void Renderer::ResolveTileSamples(int tileX, int tileY) const
+{
+	PROFILE_SCOPE("ResolveTileSamples");
+	const int startX{ tileX * m_TileSize };
+	const int startY{ tileY * m_TileSize };
+	const int tileWidth{ std::min(m_TileSize, m_Width - startX) };
+	const int endY{ std::min(startY + m_TileSize, m_Height) };
+
+	// Every channel is 8 bits whatever the layout, so averaging them byte by byte works for any order
+	auto resolvePixel = [this](int pixelIdx)
+	{
+		const __m128i zero{ _mm_setzero_si128() };
+		const __m128i samples{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_pSampleColors + size_t(pixelIdx) * m_NrSamples)) };
+		__m128i sum{ _mm_add_epi16(_mm_unpacklo_epi8(samples, zero), _mm_unpackhi_epi8(samples, zero)) };
+		sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+		sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+		m_pColorPixels[pixelIdx] = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(sum, zero)));
+	};
+
+	for (int py{ startY }; py < endY; ++py)
+	{
+		const int rowStart{ startX + py * m_Width };
+		int px{ 0 };
+
+		// Most pixels are covered by a single triangle, 16 flags are checked at once to skip past them
+		for (; px + 16 <= tileWidth; px += 16)
+		{
+			int expandedMask{ _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(m_pSampleFlags + rowStart + px))) };
+			while (expandedMask)
+			{
+				resolvePixel(rowStart + px + std::countr_zero(unsigned(expandedMask)));
+				expandedMask &= expandedMask - 1;
+			}
+		}
+		for (; px < tileWidth; ++px)
+			if (m_pSampleFlags[rowStart + px])
+				resolvePixel(rowStart + px);
+	}
+}
+
+void Renderer::UpdateRenderResolution()
+{
+	const float scale{ m_pResolutionController->GetScale() };
+	const int width{ std::clamp(int(m_OutputWidth * scale + 0.5f), 2, m_OutputWidth) };
+	const int height{ std::clamp(int(m_OutputHeight * scale + 0.5f), 2, m_OutputHeight) };
+	if (width == m_Width && height == m_Height)
+		return;
+
+	//Binning and the vertex stage of the waiting frame used the old size, so it has to go out before anything changes
+	Frame& pendingFrame{ m_Frames[1 - m_NextFrame] };
+	if (pendingFrame.isPending)
+		DrawFrame(pendingFrame);
+
+	m_Width = width;
+	m_Height = height;
+	m_NumTilesX = (m_Width + m_TileSize - 1) / m_TileSize;
+	m_NumTilesY = (m_Height + m_TileSize - 1) / m_TileSize;
+	m_IsGeometryDirty = true;
+}
+
+void Renderer::ResetTileClearFlags() const
+{
+	PROFILE_SCOPE("ResetTileClearFlags");
+	std::memset(m_pTileClearedFlags, 0, size_t(m_NumTilesX) * m_NumTilesY);
+}
+
+void Renderer::ClearTile(int tileX, int tileY) const
+{
+	PROFILE_SCOPE("ClearTile");
+	const int startX{ tileX * m_TileSize };
+	const int startY{ tileY * m_TileSize };
+	const int tileWidth{ std::min(m_TileSize, m_Width - startX) };
+	const int endY{ std::min(startY + m_TileSize, m_Height) };
+
+	for (int py{ startY }; py < endY; ++py)
+	{
+		const int rowStart{ startX + py * m_Width };
+		if (m_IsMultisampling)
+		{
+			std::fill_n(m_pSampleDepths + size_t(rowStart) * m_NrSamples, tileWidth * m_NrSamples, FLT_MAX);
+			std::fill_n(m_pSampleFlags + rowStart, tileWidth, uint8_t(0));
+		}
+		else
+			std::fill_n(m_pDepthBufferPixels + rowStart, tileWidth, FLT_MAX);
+		std::fill_n(m_pColorPixels + rowStart, tileWidth, m_ClearColor);
+	}
+}
+
+void Renderer::ResolveUntouchedTiles() const
+{
+	PROFILE_SCOPE("ResolveUntouchedTiles");
+	const __m128i clearColor{ _mm_set1_epi32(static_cast<int>(m_ClearColor)) };
+
+	for (int tileY{ 0 }; tileY < m_NumTilesY; ++tileY)
+	{
+		const int startY{ tileY * m_TileSize };
+		const int endY{ std::min(startY + m_TileSize, m_Height) };
+
+		for (int tileX{ 0 }; tileX < m_NumTilesX; ++tileX)
+		{
+			if (m_pTileClearedFlags[tileX + tileY * m_NumTilesX]) continue;
+
+			const int startX{ tileX * m_TileSize };
+			const int endX{ std::min(startX + m_TileSize, m_Width) };
 
-				m_pBackBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBackBuffer->format,
-					static_cast<uint8_t>(finalColor.r * 255),
-					static_cast<uint8_t>(finalColor.g * 255),
-					static_cast<uint8_t>(finalColor.b * 255));
+			for (int py{ startY }; py < endY; ++py)
+			{
+				uint32_t* pRow{ m_pColorPixels + py * m_Width };
+				int px{ startX };
+
+				//Scalar stores until we're 16 byte aligned, then stream past the cache since nobody reads these pixels
+				for (; px < endX && (reinterpret_cast<uintptr_t>(pRow + px) & 15); ++px)
+					pRow[px] = m_ClearColor;
+				for (; px + 4 <= endX; px += 4)
+					_mm_stream_si128(reinterpret_cast<__m128i*>(pRow + px), clearColor);
+				for (; px < endX; ++px)
+					pRow[px] = m_ClearColor;
 			}
 		}
 	}
+
+	//Make the streamed stores visible before SDL reads the surface
+	_mm_sfence();
 }
 
 void Renderer::VertexTransformationFunction(const std::vector<Vertex>& vertices_in, std::vector<Vertex>& vertices_out) const
@@ -274,26 +1358,157 @@ void Renderer::VertexTransformationFunction(const std::vector<Vertex>& vertices_
 	}
 }
 
-void Renderer::VertexTransformationFunction(Mesh& mesh) const
+int Renderer::SelectLod(const MeshInstance& instance) const
+{
+	const Mesh& mesh{ m_pScene->GetMeshes()[instance.meshIndex] };
+	if (mesh.lods.empty() || m_LodErrorThreshold <= 0.f)
+		return instance.meshIndex;
+
+	//The error gets measured on screen at the point of the bounding sphere closest to the camera
+	const Matrix& worldMatrix{ instance.worldMatrix };
+	const float scale{ std::max({ worldMatrix.GetAxisX().Magnitude(), worldMatrix.GetAxisY().Magnitude(), worldMatrix.GetAxisZ().Magnitude() }) };
+	const Vector3 center{ worldMatrix.TransformPoint(mesh.boundingSphere.center) };
+	const float distance{ std::max((center - m_Camera.origin).Magnitude() - mesh.boundingSphere.radius * scale, m_Camera.nearPlane) };
+	const float pixelsPerUnit{ m_Height * 0.5f / (distance * m_Camera.fov) };
+
+	//Coarsest level that's still within the threshold
+	int meshIndex{ instance.meshIndex };
+	for (const MeshLod& lod : mesh.lods)
+	{
+		if (lod.error * scale * pixelsPerUnit > m_LodErrorThreshold)
+			break;
+		meshIndex = lod.meshIndex;
+	}
+	return meshIndex;
+}
+
+void Renderer::CullOccludedInstances(Frame& frame, PipelineStatistics& statistics)
+{
+	PROFILE_SCOPE("CullOccludedInstances");
+
+	const std::vector<MeshInstance>& instances{ m_pScene->GetInstances() };
+	const std::vector<Mesh>& meshes{ m_pScene->GetMeshes() };
+
+	size_t maxNrOccluderVertices{ 0 };
+	for (int instanceIndex : m_VisibleInstances)
+	{
+		const int occluderMeshIndex{ instances[instanceIndex].occluderMeshIndex };
+		if (occluderMeshIndex >= 0)
+			maxNrOccluderVertices = std::max(maxNrOccluderVertices, meshes[occluderMeshIndex].positions.x.size());
+	}
+	if (maxNrOccluderVertices == 0)
+		return;
+
+	uint64_t stageStart{ StartStage() };
+	const Matrix viewProjectionMatrix{ m_Camera.viewMatrix * m_Camera.projectionMatrix };
+
+	//One scratch for all occluders, they're drawn one after the other
+	TransformedPositions scratch{};
+	VertexKernels::AllocateTransformedPositions(maxNrOccluderVertices, *frame.pArena, scratch);
+
+	//Only occluders on screen can hide anything
+	m_pOcclusionBuffer->Clear();
+	for (int instanceIndex : m_VisibleInstances)
+	{
+		const MeshInstance& instance{ instances[instanceIndex] };
+		if (instance.occluderMeshIndex >= 0)
+			m_pOcclusionBuffer->RasterizeOccluder(meshes[instance.occluderMeshIndex], instance.worldMatrix * viewProjectionMatrix, scratch);
+	}
+
+	const auto occludedBegin = std::remove_if(m_VisibleInstances.begin(), m_VisibleInstances.end(), [&](int instanceIndex)
+		{
+			return m_pOcclusionBuffer->IsOccluded(m_pScene->GetInstanceBounds(instanceIndex), viewProjectionMatrix);
+		});
+	statistics.occlusionCulled += m_VisibleInstances.end() - occludedBegin;
+	m_VisibleInstances.erase(occludedBegin, m_VisibleInstances.end());
+
+	EndStage(frame, RenderStage::occlusion, stageStart);
+}
+
+void Renderer::CullMeshlets(DrawCall& drawCall, const Matrix& worldMatrix, const Frustum& frustum, FrameArena& arena, PipelineStatistics& statistics) const
+{
+	PROFILE_SCOPE("CullMeshlets");
+
+	//The normal cones are in object space as well, so the camera goes there too
+	const Vector3 cameraPosition{ Matrix::Inverse(worldMatrix).TransformPoint(m_Camera.origin) };
+
+	const Mesh& mesh{ *drawCall.pMesh };
+
+	uint32_t* pVisibleMeshlets{ arena.Allocate<uint32_t>(mesh.meshlets.size()) };
+	size_t nrVisibleMeshlets{ 0 };
+	for (uint32_t meshletIndex{ 0 }; meshletIndex < mesh.meshlets.size(); ++meshletIndex)
+	{
+		const Meshlet& meshlet{ mesh.meshlets[meshletIndex] };
+
+		if (frustum.IsOutside(meshlet.boundingSphere) || frustum.IsOutside(meshlet.boundingBox) ||
+			Culling::IsBackFacing(meshlet, cameraPosition))
+		{
+			++statistics.meshletsCulled;
+			continue;
+		}
+
+		pVisibleMeshlets[nrVisibleMeshlets++] = meshletIndex;
+	}
+	drawCall.visibleMeshlets = { pVisibleMeshlets, nrVisibleMeshlets };
+}
+
+void Renderer::VertexTransformationFunction(DrawCall& drawCall, FrameArena& arena, PipelineStatistics& statistics) const
 {
-	const Matrix worldViewMatrix = mesh.worldMatrix * m_Camera.viewMatrix * m_Camera.projectionMatrix;
+	PROFILE_SCOPE("VertexTransformation");
+
+	const Mesh& mesh{ *drawCall.pMesh };
 
-	for (const Vertex& vertex : mesh.vertices)
+	//Indexed by vertex like the mesh, only the vertices of visible meshlets get written
+	VertexKernels::AllocateTransformedPositions(mesh.positions.x.size(), arena, drawCall.positions);
+
+	const bool isLit{ m_CurrentRenderingMode == RenderingModes::lit };
+	if (isLit)
+		VertexKernels::AllocateLitAttributes(mesh.positions.x.size(), arena, drawCall.positions);
+
+	auto transformRange = [&](size_t firstVertex, size_t nrVertices)
 	{
-		Vertex_Out vertexOut{Vector4{}, vertex.color, vertex.uv};
+		statistics.verticesTransformed += nrVertices;
+		VertexKernels::TransformPositions(drawCall.worldViewProjectionMatrix, m_Width, m_Height, mesh.positions, firstVertex, nrVertices, drawCall.positions);
+		VertexKernels::DecodeTexCoords(mesh.attributes, firstVertex, nrVertices, drawCall.positions);
+		if (isLit)
+			VertexKernels::TransformLitAttributes(drawCall.worldMatrix, mesh.positions, mesh.attributes, firstVertex, nrVertices, drawCall.positions);
+	};
 
-		vertexOut.position = worldViewMatrix.TransformPoint({ vertex.position, 1.f });
+	size_t nrVisibleVertices{ 0 };
+	for (uint32_t meshletIndex : drawCall.visibleMeshlets)
+		nrVisibleVertices += mesh.meshlets[meshletIndex].nrVertices;
 
-		vertexOut.position.x /= vertexOut.position.w;
-		vertexOut.position.y /= vertexOut.position.w;
-		vertexOut.position.z /= vertexOut.position.w;
+	//Meshlets whose vertices are spread out can overlap, then doing everything at once is cheaper
+	if (nrVisibleVertices >= mesh.positions.x.size())
+	{
+		transformRange(0, mesh.positions.x.size());
+		return;
+	}
 
-		mesh.vertices_out.push_back(vertexOut);
+	//Only the vertices of visible meshlets, neighbouring ranges are merged into one call
+	size_t rangeStart{ 0 };
+	size_t rangeEnd{ 0 };
+	for (uint32_t meshletIndex : drawCall.visibleMeshlets)
+	{
+		const Meshlet& meshlet{ mesh.meshlets[meshletIndex] };
+		if (meshlet.firstVertex != rangeEnd)
+		{
+			if (rangeEnd > rangeStart)
+				transformRange(rangeStart, rangeEnd - rangeStart);
+			rangeStart = meshlet.firstVertex;
+		}
+		rangeEnd = meshlet.firstVertex + meshlet.nrVertices;
 	}
+	if (rangeEnd > rangeStart)
+		transformRange(rangeStart, rangeEnd - rangeStart);
 }
 
 bool Renderer::SaveBufferToImage() const
 {
+	//The presenter only reads the last drawn buffer, it's safe to save while it's still being presented
+	if (!m_pBackBuffer)
+		return true;
+
 	return SDL_SaveBMP(m_pBackBuffer, "Rasterizer_ColorBuffer.bmp");
 }
 
@@ -302,13 +1517,34 @@ void Renderer::ToggleRenderMode()
 	switch (m_CurrentRenderingMode)
 	{
 	case RenderingModes::texture:
+		m_CurrentRenderingMode = RenderingModes::lit;
+		//The vertex stage only prepares the attributes of the lit mode when it's on
+		m_IsGeometryDirty = true;
+		break;
+	case RenderingModes::lit:
 		m_CurrentRenderingMode = RenderingModes::depthValues;
 		break;
 	case RenderingModes::depthValues:
 		m_CurrentRenderingMode = RenderingModes::boundingBox;
 		break;
 	case RenderingModes::boundingBox:
+		m_CurrentRenderingMode = RenderingModes::overdraw;
+		break;
+	case RenderingModes::overdraw:
 		m_CurrentRenderingMode = RenderingModes::texture;
 		break;
 	}
+
+	m_IsImageDirty = true;
+}
+
+void Renderer::SetLitShading(bool isEnabled)
+{
+	const RenderingModes mode{ isEnabled ? RenderingModes::lit : RenderingModes::texture };
+	if (mode == m_CurrentRenderingMode)
+		return;
+
+	m_CurrentRenderingMode = mode;
+	m_IsGeometryDirty |= isEnabled;
+	m_IsImageDirty = true;
 }
\ No newline at end of file
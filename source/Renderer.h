@@ -1,12 +1,13 @@
 #pragma once
 
 #include <cstdint>
+#include <span>
 #include <vector>
 
 #include "Camera.h"
 #include "DataTypes.h"
+#include "RenderStats.h"
 
-struct SDL_Window;
 struct SDL_Surface;
 
 namespace dae
@@ -16,12 +17,31 @@ namespace dae
 	struct Mesh;
 	struct Vertex;
 	class Timer;
+	class JobSystem;
+	class FrameArena;
+	class OcclusionBuffer;
+	class Presenter;
+	class ResolutionController;
+	class Upscaler;
+	class EdgeAntialiaser;
+	class TileBins;
 	class Scene;
+	struct MeshInstance;
+	class RenderTarget;
+
+	//What the scene starts out with. Only the vehicle has normal, specular and gloss maps, the tuktuk is lit with its plain normals
+	enum class DefaultModel
+	{
+		tuktuk,
+		vehicle
+	};
 
 	class Renderer final
 	{
 	public:
-		Renderer(SDL_Window* pWindow);
+		//The vertex layout decides how compactly the mesh attributes are stored, see VertexLayout::Compact.
+		//Loading and every stage of a frame run their work on the job system, it has to outlive the renderer
+		Renderer(RenderTarget* pRenderTarget, JobSystem* pJobSystem, const VertexLayout& vertexLayout = VertexLayout::Full(), DefaultModel model = DefaultModel::tuktuk);
 		~Renderer();
 
 		Renderer(const Renderer&) = delete;
@@ -30,44 +50,299 @@ namespace dae
 		Renderer& operator=(Renderer&&) noexcept = delete;
 
 		void Update(Timer* pTimer);
+
+		//With pipelining the geometry of this frame is prepared while the one from the last call gets rasterized and presented,
+		//so what shows up is always one frame behind. The scene's meshes and textures may only change after a Flush.
+		//When neither the camera, the scene nor any setting changed the vertex stage is skipped, and when the frame on screen is already up to date nothing is drawn at all
 		void Render();
 
+		//The last Render had nothing to do, the render target still shows the same frame
+		bool WasFrameSkipped() const { return m_WasFrameSkipped; }
+
+		//Benchmarks want every frame drawn in full, even when the camera didn't move
+		void SetSkipUnchangedFrames(bool skip) { m_SkipUnchangedFrames = skip; }
+		bool IsSkippingUnchangedFrames() const { return m_SkipUnchangedFrames; }
+
+		//Rasterizes and presents the frame that's still waiting, if there is one
+		void Flush();
+
+		//Turning it off flushes, after that every Render presents its own frame
+		void SetFramePipelining(bool isEnabled);
+		bool IsFramePipelining() const { return m_IsPipeliningEnabled; }
+
+		//Places the camera directly, used instead of Update when there's no input to react to
+		void SetCameraTransform(const Vector3& origin, const Vector3& forward);
+
+		//Stage timings cost a few counter reads per triangle so they're only measured when asked for.
+		//They belong to the last presented frame, the same one as GetStatistics
+		void SetMeasureStageTimings(bool measure) { m_MeasureStageTimings = measure; }
+		bool IsMeasuringStageTimings() const { return m_MeasureStageTimings; }
+		const StageTimings& GetStageTimings() const { return m_StageTimings; }
+
+		//Instance under the pixel or -1, distance is how far it is from the camera
+		int Pick(int x, int y, float& distance);
+
+		//Meshes, textures and instances that get drawn, owned by the renderer
+		Scene& GetScene() { return *m_pScene; }
+
+		//Instances hidden behind the occluders of other instances are skipped, only does something when the scene has occluders
+		void SetOcclusionCulling(bool isEnabled) { m_IsOcclusionCullingEnabled = isEnabled; m_IsGeometryDirty = true; }
+
+		//How many pixels a simplified mesh may be off on screen before a more detailed one is used, 0 always draws the full meshes
+		void SetLodErrorThreshold(float pixels) { m_LodErrorThreshold = pixels; m_IsGeometryDirty = true; }
+
+		//Counters of the last presented frame, with pipelining that's the one before the last Render
+		const PipelineStatistics& GetStatistics() const { return m_Statistics; }
+
+		//4x multisampling: coverage and depth are tested for 4 samples per pixel, but every pixel is still only shaded once
+		void SetMultisampling(bool isEnabled);
+		bool IsMultisampling() const { return m_IsMultisampling; }
+
+		//Lowers the render resolution when frames take longer than this and raises it again when there's time left, 0 always renders at the maximum scale.
+		//Frames below the output resolution are scaled up when presenting
+		void SetFrameTimeBudget(float milliseconds);
+		//Limits of the render resolution as a fraction of the output, the maximum is the fixed scale used without a budget
+		void SetResolutionScaleRange(float minScale, float maxScale);
+		//Width of the render resolution over the one of the output, of the frame that was prepared last
+		float GetResolutionScale() const;
+
 		bool SaveBufferToImage() const;
 		void ToggleRenderMode();
 
+		//Blinn-Phong with one directional light, using the normal, specular and gloss maps of the instances that have them.
+		//Switches between the lit and the texture mode, ToggleRenderMode goes through it as well
+		void SetLitShading(bool isEnabled);
+		bool IsLitShading() const { return m_CurrentRenderingMode == RenderingModes::lit; }
+
+		//Smooths edges after drawing by blending across them, a lot cheaper than multisampling but it can't add any detail
+		void SetEdgeAntialiasing(bool isEnabled);
+		void ToggleEdgeAntialiasing() { SetEdgeAntialiasing(!m_IsEdgeAntialiasing); }
+		bool IsEdgeAntialiasing() const { return m_IsEdgeAntialiasing; }
+
+		//Triangles are binned into square tiles of this many pixels, every tile is drawn by one job
+		static constexpr int m_TileSize{ 32 };
+		//Binning is split in jobs of about this many triangles, whole meshlets at a time
+		static constexpr size_t m_NrTrianglesPerBinBatch{ 512 };
+
 	private:
-		SDL_Window* m_pWindow{};
+		RenderTarget* m_pRenderTarget{};
 
-		SDL_Surface* m_pFrontBuffer{ nullptr };
+		//Owns the back buffer, which may be the surface of the render target itself
+		Presenter* m_pPresenter{};
 		SDL_Surface* m_pBackBuffer{ nullptr };
 		uint32_t* m_pBackBufferPixels{};
 
+		//Where the tiles get drawn: the back buffer at full resolution, otherwise a buffer of the render resolution that's scaled up onto it.
+		//Edge anti-aliasing also needs the image somewhere else, it filters it onto the back buffer
+		uint32_t* m_pColorPixels{};
+		uint32_t* m_pLowResolutionPixels{};
+		Upscaler* m_pUpscaler{};
+		ResolutionController* m_pResolutionController{};
+
+		//Filtering happens at the render resolution, when that gets scaled up it goes through a buffer of its own first
+		bool m_IsEdgeAntialiasing{ false };
+		EdgeAntialiaser* m_pEdgeAntialiaser{};
+		uint32_t* m_pAntialiasedPixels{};
+
 		float* m_pDepthBufferPixels{};
 
+		//Tiles are cleared lazily the first time a triangle touches them,
+		//untouched tiles are resolved to the clear color when presenting
+		int m_NumTilesX{};
+		int m_NumTilesY{};
+		uint8_t* m_pTileClearedFlags{};
+		uint32_t m_ClearColor{ 0 };
+
+		//Channel layout of the back buffer so colors can be packed without going through SDL_MapRGB
+		struct PixelLayout
+		{
+			int redShift{};
+			int greenShift{};
+			int blueShift{};
+			uint32_t alphaMask{};
+			bool isPackable{};
+		};
+		PixelLayout m_PixelLayout{};
+
 		Camera m_Camera{};
 
-		Texture* m_pTexture{};
-		Mesh m_Mesh{};
+		Scene* m_pScene{};
+		JobSystem* m_pJobSystem{};
 
+		//Low resolution depth of the occluders, filled at the start of every frame
+		OcclusionBuffer* m_pOcclusionBuffer{};
+		bool m_IsOcclusionCullingEnabled{ true };
+
+		float m_LodErrorThreshold{ 1.f };
+
+		//Render resolution, every buffer the rasterizer works on has its rows this far apart.
+		//It only changes in between frames, the buffers have room for the full output resolution
 		int m_Width{};
 		int m_Height{};
+		int m_OutputWidth{};
+		int m_OutputHeight{};
 
 		float m_AspectRatio{};
 		
 		enum RenderingModes
 		{
 			texture,
+			lit,
 			boundingBox,
-			depthValues
+			depthValues,
+			overdraw
 		};
 		RenderingModes m_CurrentRenderingMode{ texture };
 
+		bool m_MeasureStageTimings{ false };
+		StageTimings m_StageTimings{};
+
+		//Stages that run on several threads add up the time every thread spent in them
+		struct alignas(64) StageCounts
+		{
+			uint64_t counts[int(RenderStage::count)]{};
+		};
+
+		//Merged counters of the last frame that was presented
+		PipelineStatistics m_Statistics{};
+
+		//How many times every pixel passed the depth test this frame, only used by the overdraw mode
+		uint8_t* m_pOverdrawPixels{};
+
+		//Specular powers for the lit mode instead of calling pow per pixel, a row of cosines for every gloss level
+		float* m_pSpecularPowers{};
+
+		//Multisampling keeps a depth per sample, but colors per sample only for pixels that more than one triangle shows up in.
+		//A pixel one triangle covers completely keeps its color in the color buffer, so resolving only has to look at the others.
+		//The buffers are only created once multisampling gets turned on
+		static constexpr int m_NrSamples{ 4 };
+		bool m_IsMultisampling{ false };
+		float* m_pSampleDepths{};
+		uint32_t* m_pSampleColors{};
+		//0xFF when the colors of the pixel are in its samples, 0 when the color buffer has it
+		uint8_t* m_pSampleFlags{};
+
+		std::vector<int> m_VisibleInstances{};
+
+		//Everything needed to draw one visible instance, it and its buffers live in the frame arena
+		struct DrawCall
+		{
+			const Mesh* pMesh{};
+			const Texture* pTexture{};
+			Matrix worldViewProjectionMatrix{};
+
+			//Only used by the lit mode, the maps are nullptr when the instance doesn't have them
+			Matrix worldMatrix{};
+			const Texture* pNormalMap{};
+			const Texture* pSpecularMap{};
+			const Texture* pGlossMap{};
+
+			//Indices into the meshlets of the mesh that survived culling
+			std::span<uint32_t> visibleMeshlets{};
+
+			//Output of the vertex stage, every instance has its own so they can all be transformed at the same time
+			TransformedPositions positions{};
+		};
+
+		//What the geometry stages hand over to the rasterizer. There are two so the next frame can be prepared while the last one is drawn
+		struct Frame
+		{
+			DrawCall* pDrawCalls{};
+			size_t nrDrawCalls{};
+
+			//Where the camera was when the frame got prepared, the camera itself may already have moved on to the next one while this one is drawn
+			Vector3 cameraOrigin{};
+
+			//Triangles that touch a tile in the order they were submitted, so every tile can be rasterized on its own
+			TileBins* pTileBins{};
+
+			//Everything that only lives until the frame is drawn, reset when the frame gets prepared again
+			FrameArena* pArena{};
+
+			//One set of counters per thread, merged into m_Statistics once the frame is presented
+			std::vector<PipelineStatistics> threadStatistics{};
+
+			//Time the threads spent in every stage of this frame, the geometry stages are added up once the frame is prepared
+			std::vector<StageCounts> threadStageCounts{};
+			StageCounts preparedStageCounts{};
+
+			//Prepared but not drawn yet
+			bool isPending{};
+		};
+		Frame m_Frames[2]{};
+		int m_NextFrame{ 0 };
+
+		//Attributes of a triangle for the lit mode: world position, normal and tangent of its third vertex and how far the other two are from it.
+		//A pixel only needs the perspective correct weights of the first two vertices to get all of them
+		struct LitTriangle
+		{
+			Vector3 attributes[3]{};
+			Vector3 deltas0[3]{};
+			Vector3 deltas1[3]{};
+		};
+
+		bool m_IsPipeliningEnabled{ true };
+
+		//What the last prepared frame was made of. As long as none of it changes that frame can be drawn again without preparing a new one
+		uint64_t m_PreparedCameraVersion{};
+		uint64_t m_PreparedSceneVersion{};
+		bool m_IsGeometryDirty{ true };
+		//Only the way the frame is drawn changed, like the rendering mode
+		bool m_IsImageDirty{ true };
+		bool m_SkipUnchangedFrames{ true };
+		bool m_WasFrameSkipped{ false };
 
 		//Function that transforms the vertices from the mesh from World space to Screen space
 		void VertexTransformationFunction(const std::vector<Vertex>& vertices_in, std::vector<Vertex>& vertices_out) const; //W1 Version
-		void VertexTransformationFunction(Mesh& mesh) const;
+		void VertexTransformationFunction(DrawCall& drawCall, FrameArena& arena, PipelineStatistics& statistics) const;
+
+		//Draws the occluders of the visible instances into the occlusion buffer and drops the instances that end up behind them
+		void CullOccludedInstances(Frame& frame, PipelineStatistics& statistics);
+
+		//Mesh to draw the instance with, one of its levels of detail when they're close enough on screen
+		int SelectLod(const MeshInstance& instance) const;
+
+		//Fills the visible meshlets of the draw call with the ones that survive the frustum and normal cone tests
+		void CullMeshlets(DrawCall& drawCall, const Matrix& worldMatrix, const Frustum& frustum, FrameArena& arena, PipelineStatistics& statistics) const;
+
+		//Culling, vertex stage and binning for the current camera, only reads the scene
+		void PrepareFrame(Frame& frame);
+		//Rasterizes the bins of the frame and presents it
+		void DrawFrame(Frame& frame);
+
+		//Throws out the triangles that can't cover anything and adds the others to the bins of the tiles they touch
+		void BinTriangles(Frame& frame) const;
+		void BinTriangle(Frame& frame, int threadIndex, uint32_t drawIndex, int firstIndex, PipelineStatistics& statistics) const;
+
+		//Pixels a triangle could touch, [minX, maxX) x [minY, maxY)
+		void GetPixelBounds(const Vector2& vertex0, const Vector2& vertex1, const Vector2& vertex2, int& minX, int& minY, int& maxX, int& maxY) const;
+
+		void RasterizeTile(Frame& frame, int tileIndex);
+		void RenderTriangle(Frame& frame, const DrawCall& drawCall, int currentVertexIndex, bool swapVertex, int tileX, int tileY, PipelineStatistics& statistics) const;
+
+		void InitializeSpecularPowers();
+		void SetUpLitTriangle(const TransformedPositions& positions, size_t vertexIndex0, size_t vertexIndex1, size_t vertexIndex2, LitTriangle& triangle) const;
+		//Shades 4 pixels at once from their weights and uvs, lanes that aren't covered are shaded from zero weights and thrown away
+		void ShadeLitQuad(const Frame& frame, const DrawCall& drawCall, const LitTriangle& triangle, const float weights0[4], const float weights1[4], const Vector2 uvs[4], ColorRGB colors[4]) const;
+		void ResolveOverdraw() const;
+
+		uint64_t StartStage() const;
+		void EndStage(Frame& frame, RenderStage stage, uint64_t& stageStart) const;
+
+		void InitializePixelLayout();
+		void PackPixelQuad(const ColorRGB colors[4], uint32_t packedPixels[4]) const;
+		void WritePixelQuad(int firstPixelIdx, const ColorRGB colors[4], int coverageMask) const;
+
+		//Only the samples in the mask get the color, a pixel that's covered completely goes back to a single color
+		void WriteSamples(int pixelIdx, uint32_t color, int sampleMask) const;
+		//Averages the samples of every pixel in the tile that has them into the color buffer
+		void ResolveTileSamples(int tileX, int tileY) const;
+
+		//Applies the scale of the resolution controller, a pending frame still gets drawn at the size it was prepared at
+		void UpdateRenderResolution();
 
-		void RenderTriangle(const Mesh& mesh, const std::vector<Vector2>& verteciesRaster,
-			int currentVertexIndex, bool swapVertex) const;
+		void ResetTileClearFlags() const;
+		void ClearTile(int tileX, int tileY) const;
+		void ResolveUntouchedTiles() const;
 	};
 }
@@ -0,0 +1,76 @@
+#include "ResolutionController.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace dae
+{
+	namespace
+	{
+		//Aim a bit under the budget so a frame that's slightly slower than the last one still makes it
+		constexpr float g_TargetFraction{ 0.9f };
+		//Going up is only worth it when it's noticeably sharper, that also keeps the size from flickering around the budget
+		constexpr float g_MinScaleIncrease{ 0.05f };
+		constexpr float g_MinScaleDecrease{ 0.02f };
+		constexpr float g_MaxScaleIncrease{ 0.1f };
+		constexpr int g_NrSettleFrames{ 2 };
+	}
+
+	void ResolutionController::SetBudget(float milliseconds)
+	{
+		m_BudgetMilliseconds = std::max(milliseconds, 0.f);
+		m_SmoothedMilliseconds = 0.f;
+		m_NrFramesToSettle = 0;
+
+		if (m_BudgetMilliseconds <= 0.f)
+			m_Scale = m_MaxScale;
+	}
+
+	void ResolutionController::SetScaleRange(float minScale, float maxScale)
+	{
+		m_MaxScale = std::clamp(maxScale, 0.1f, 1.f);
+		m_MinScale = std::clamp(minScale, 0.1f, m_MaxScale);
+		m_Scale = m_BudgetMilliseconds > 0.f ? std::clamp(m_Scale, m_MinScale, m_MaxScale) : m_MaxScale;
+	}
+
+	void ResolutionController::AddFrameTime(float milliseconds)
+	{
+		if (m_BudgetMilliseconds <= 0.f || milliseconds <= 0.f)
+			return;
+
+		if (m_NrFramesToSettle > 0)
+		{
+			--m_NrFramesToSettle;
+			m_SmoothedMilliseconds = milliseconds;
+			return;
+		}
+
+		const float targetMilliseconds{ m_BudgetMilliseconds * g_TargetFraction };
+
+		//A spike goes straight in, one slow frame is already a missed deadline
+		if (milliseconds > m_BudgetMilliseconds)
+		{
+			m_SmoothedMilliseconds = milliseconds;
+			SetScale(m_Scale * std::sqrt(targetMilliseconds / milliseconds));
+			return;
+		}
+
+		m_SmoothedMilliseconds = m_SmoothedMilliseconds > 0.f ? m_SmoothedMilliseconds + (milliseconds - m_SmoothedMilliseconds) * 0.25f : milliseconds;
+
+		const float idealScale{ m_Scale * std::sqrt(targetMilliseconds / m_SmoothedMilliseconds) };
+		if (idealScale < m_Scale - g_MinScaleDecrease)
+			SetScale(idealScale);
+		else if (idealScale > m_Scale + g_MinScaleIncrease)
+			SetScale(std::min(idealScale, m_Scale + g_MaxScaleIncrease));
+	}
+
+	void ResolutionController::SetScale(float scale)
+	{
+		scale = std::clamp(scale, m_MinScale, m_MaxScale);
+		if (scale == m_Scale)
+			return;
+
+		m_Scale = scale;
+		m_NrFramesToSettle = g_NrSettleFrames;
+	}
+}
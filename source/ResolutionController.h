@@ -0,0 +1,37 @@
+#pragma once
+
+namespace dae
+{
+	//Picks the scale of the render resolution so frames stay within a time budget.
+	//Drawing cost mostly follows the number of pixels, so the scale moves with the square root of how far off the frames are.
+	//It drops right away when a frame runs over and only creeps back up, a blurrier frame beats a late one
+	class ResolutionController final
+	{
+	public:
+		ResolutionController() = default;
+
+		//0 turns the controller off, the scale then stays at the maximum
+		void SetBudget(float milliseconds);
+		float GetBudget() const { return m_BudgetMilliseconds; }
+
+		//Upper and lower limit of the scale, the maximum is also what's used without a budget
+		void SetScaleRange(float minScale, float maxScale);
+
+		//Time the last frame took at the current scale
+		void AddFrameTime(float milliseconds);
+
+		float GetScale() const { return m_Scale; }
+
+	private:
+		float m_BudgetMilliseconds{ 0.f };
+		float m_MinScale{ 0.5f };
+		float m_MaxScale{ 1.f };
+		float m_Scale{ 1.f };
+
+		float m_SmoothedMilliseconds{ 0.f };
+		//The frames right after a change still partly ran at the old size, they don't say much about the new one
+		int m_NrFramesToSettle{ 0 };
+
+		void SetScale(float scale);
+	};
+}
@@ -0,0 +1,247 @@
+#include "Scene.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "JobSystem.h"
+#include "Simplifier.h"
+#include "Texture.h"
+#include "Utils.h"
+#include "VertexKernels.h"
+
+namespace dae
+{
+	namespace
+	{
+		//Moller-Trumbore, both sides count so the back of a vehicle can be picked as well
+		bool IntersectTriangle(const Ray& ray, const Vector3& p0, const Vector3& p1, const Vector3& p2, float& distance)
+		{
+			const Vector3 edge0{ p1 - p0 };
+			const Vector3 edge1{ p2 - p0 };
+
+			const Vector3 p{ Vector3::Cross(ray.direction, edge1) };
+			const float determinant{ Vector3::Dot(edge0, p) };
+			if (std::abs(determinant) < 1e-8f)
+				return false;
+
+			const float invDeterminant{ 1.f / determinant };
+			const Vector3 toOrigin{ ray.origin - p0 };
+
+			const float u{ Vector3::Dot(toOrigin, p) * invDeterminant };
+			if (u < 0.f || u > 1.f)
+				return false;
+
+			const Vector3 q{ Vector3::Cross(toOrigin, edge0) };
+			const float v{ Vector3::Dot(ray.direction, q) * invDeterminant };
+			if (v < 0.f || u + v > 1.f)
+				return false;
+
+			distance = Vector3::Dot(edge1, q) * invDeterminant;
+			return distance >= 0.f && distance < ray.maxDistance;
+		}
+
+		bool RaycastMesh(const Mesh& mesh, const Ray& ray, float& hitDistance)
+		{
+			const Vector3 invDirection{ 1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z };
+			const PositionStream& positions{ mesh.positions };
+
+			auto getPosition = [&positions](uint32_t index)
+			{
+				return Vector3{ positions.x[index], positions.y[index], positions.z[index] };
+			};
+
+			Ray clippedRay{ ray };
+			bool isHit{ false };
+
+			//The meshlet boxes skip most of the triangles
+			for (const Meshlet& meshlet : mesh.meshlets)
+			{
+				float entryDistance{};
+				if (!IntersectRay(clippedRay, invDirection, meshlet.boundingBox, entryDistance))
+					continue;
+
+				const uint32_t lastIndex{ meshlet.firstIndex + meshlet.nrIndices };
+				const uint32_t step{ mesh.primitiveTopology == PrimitiveTopology::TriangleStrip ? 1u : 3u };
+				for (uint32_t i{ meshlet.firstIndex }; i + 2 < lastIndex; i += step)
+				{
+					float distance{};
+					if (IntersectTriangle(clippedRay, getPosition(mesh.indices[i]), getPosition(mesh.indices[i + 1]),
+						getPosition(mesh.indices[i + 2]), distance))
+					{
+						clippedRay.maxDistance = distance;
+						isHit = true;
+					}
+				}
+			}
+
+			if (isHit)
+				hitDistance = clippedRay.maxDistance;
+			return isHit;
+		}
+	}
+
+	Scene::Scene(JobSystem* pJobSystem) :
+		m_pJobSystem{ pJobSystem }
+	{
+	}
+
+	Scene::~Scene()
+	{
+		for (Texture* pTexture : m_pTextures)
+			delete pTexture;
+	}
+
+	int Scene::AddMesh(const std::string& objPath, const VertexLayout& vertexLayout, int maxNrLods)
+	{
+		std::vector<Vertex> vertices{};
+		std::vector<uint32_t> indices{};
+		if (!Utils::ParseOBJ(objPath, vertices, indices))
+			return -1;
+
+		//Every level is simplified from the full mesh so its error is measured against the real surface,
+		//that also means they don't depend on each other and can all be built at the same time
+		struct Level
+		{
+			Mesh mesh{};
+			size_t nrTriangles{};
+			float error{};
+		};
+		std::vector<Level> levels(std::max(maxNrLods, 0));
+		m_pJobSystem->ParallelFor(levels.size(), 1, [&](size_t first, size_t last)
+			{
+				for (size_t level{ first }; level < last; ++level)
+				{
+					std::vector<Vertex> lodVertices{};
+					std::vector<uint32_t> lodIndices{};
+					levels[level].error = Simplifier::Simplify(vertices, indices, (indices.size() / 3) >> (level + 1), lodVertices, lodIndices);
+					levels[level].nrTriangles = lodIndices.size() / 3;
+					levels[level].mesh = CreateMesh(std::move(lodVertices), std::move(lodIndices), vertexLayout);
+				}
+			});
+
+		const int meshIndex{ int(m_Meshes.size()) };
+		m_Meshes.push_back(CreateMesh(std::move(vertices), std::move(indices), vertexLayout));
+		++m_Version;
+
+		size_t nrTriangles{ m_Meshes[meshIndex].indices.size() / 3 };
+		float error{ 0.f };
+		for (Level& level : levels)
+		{
+			//Locked borders and seams stop the simplifier at some point, levels that barely change aren't worth keeping
+			if (level.nrTriangles == 0 || level.nrTriangles > nrTriangles * 3 / 4)
+				break;
+
+			nrTriangles = level.nrTriangles;
+			error = std::max(error, level.error);
+			m_Meshes[meshIndex].lods.push_back({ int(m_Meshes.size()), error });
+			m_Meshes.push_back(std::move(level.mesh));
+		}
+
+		return meshIndex;
+	}
+
+	int Scene::AddTexture(const std::string& path)
+	{
+		m_pTextures.push_back(Texture::LoadFromFile(path));
+		++m_Version;
+		return int(m_pTextures.size()) - 1;
+	}
+
+	int Scene::AddInstance(int meshIndex, int textureIndex, const Matrix& worldMatrix)
+	{
+		assert(meshIndex >= 0 && meshIndex < int(m_Meshes.size()));
+		assert(textureIndex >= 0 && textureIndex < int(m_pTextures.size()));
+
+		m_Instances.push_back({ meshIndex, textureIndex, worldMatrix, -1 });
+		m_InstanceBounds.push_back(Culling::TransformBounds(m_Meshes[meshIndex].boundingBox, worldMatrix));
+		m_IsBvhOutdated = true;
+		++m_Version;
+
+		return int(m_Instances.size()) - 1;
+	}
+
+	void Scene::SetWorldMatrix(int instanceIndex, const Matrix& worldMatrix)
+	{
+		MeshInstance& instance{ m_Instances[instanceIndex] };
+		instance.worldMatrix = worldMatrix;
+
+		m_InstanceBounds[instanceIndex] = Culling::TransformBounds(m_Meshes[instance.meshIndex].boundingBox, worldMatrix);
+		m_IsBvhRefitNeeded = true;
+		++m_Version;
+	}
+
+	void Scene::SetOccluder(int instanceIndex, int occluderMeshIndex)
+	{
+		assert(occluderMeshIndex >= -1 && occluderMeshIndex < int(m_Meshes.size()));
+		m_Instances[instanceIndex].occluderMeshIndex = occluderMeshIndex;
+		++m_Version;
+	}
+
+	void Scene::SetMaterialMaps(int instanceIndex, int normalMapIndex, int specularMapIndex, int glossMapIndex)
+	{
+		assert(normalMapIndex >= -1 && normalMapIndex < int(m_pTextures.size()));
+		assert(specularMapIndex >= -1 && specularMapIndex < int(m_pTextures.size()));
+		assert(glossMapIndex >= -1 && glossMapIndex < int(m_pTextures.size()));
+
+		MeshInstance& instance{ m_Instances[instanceIndex] };
+		instance.normalMapIndex = normalMapIndex;
+		instance.specularMapIndex = specularMapIndex;
+		instance.glossMapIndex = glossMapIndex;
+		++m_Version;
+	}
+
+	void Scene::CullInstances(const Frustum& worldFrustum, std::vector<int>& visibleInstances)
+	{
+		UpdateBvh();
+
+		visibleInstances.clear();
+		m_Bvh.Query(worldFrustum, visibleInstances);
+
+		//The hierarchy returns them in tree order, drawing keeps the order of the scene so the output doesn't depend on the tree
+		std::sort(visibleInstances.begin(), visibleInstances.end());
+	}
+
+	int Scene::Raycast(const Ray& ray, float& hitDistance)
+	{
+		UpdateBvh();
+
+		return m_Bvh.Raycast(ray, [this, &ray](int instanceIndex, float& distance)
+			{
+				const MeshInstance& instance{ m_Instances[instanceIndex] };
+
+				//The ray goes to object space, its direction isn't normalized again so distances stay comparable between instances
+				const Matrix invWorldMatrix{ Matrix::Inverse(instance.worldMatrix) };
+				const Ray objectRay{ invWorldMatrix.TransformPoint(ray.origin), invWorldMatrix.TransformVector(ray.direction), ray.maxDistance };
+
+				return RaycastMesh(m_Meshes[instance.meshIndex], objectRay, distance);
+			}, hitDistance);
+	}
+
+	Mesh Scene::CreateMesh(std::vector<Vertex>&& vertices, std::vector<uint32_t>&& indices, const VertexLayout& vertexLayout)
+	{
+		Mesh mesh{};
+		mesh.vertices = std::move(vertices);
+		mesh.indices = std::move(indices);
+		mesh.primitiveTopology = PrimitiveTopology::TriangleList;
+
+		VertexKernels::BuildPositionStream(mesh.vertices, mesh.positions);
+		VertexFormat::PackAttributes(mesh.vertices, vertexLayout, mesh.attributes);
+		Culling::ComputeBounds(mesh.positions, mesh.boundingBox, mesh.boundingSphere);
+		Culling::BuildMeshlets(mesh.positions, mesh.indices, mesh.primitiveTopology, mesh.meshlets);
+
+		//Everything the pipeline reads now lives in the position stream and the packed attributes
+		std::vector<Vertex>{}.swap(mesh.vertices);
+		return mesh;
+	}
+
+	void Scene::UpdateBvh()
+	{
+		if (m_IsBvhOutdated)
+			m_Bvh.Build(m_InstanceBounds);
+		else if (m_IsBvhRefitNeeded)
+			m_Bvh.Refit(m_InstanceBounds);
+
+		m_IsBvhOutdated = false;
+		m_IsBvhRefitNeeded = false;
+	}
+}
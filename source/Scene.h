@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BVH.h"
+#include "DataTypes.h"
+
+namespace dae
+{
+	class JobSystem;
+	class Texture;
+
+	//One placement of a mesh, every instance of a mesh shares its geometry and only brings its own transform
+	struct MeshInstance
+	{
+		int meshIndex{};
+		int textureIndex{};
+		Matrix worldMatrix{};
+
+		//Mesh drawn into the occlusion buffer to hide what's behind this instance, -1 when it doesn't hide anything.
+		//Usually a simpler version of the mesh itself, it has to stay inside of what actually gets drawn
+		int occluderMeshIndex{ -1 };
+
+		//Textures only the lit mode uses, -1 when the instance doesn't have that map
+		int normalMapIndex{ -1 };
+		int specularMapIndex{ -1 };
+		int glossMapIndex{ -1 };
+	};
+
+	class Scene final
+	{
+	public:
+		//Loading spreads its work over the job system
+		explicit Scene(JobSystem* pJobSystem);
+		~Scene();
+
+		Scene(const Scene&) = delete;
+		Scene(Scene&&) noexcept = delete;
+		Scene& operator=(const Scene&) = delete;
+		Scene& operator=(Scene&&) noexcept = delete;
+
+		//Loads the geometry once, returns the index instances refer to or -1 when the file couldn't be read.
+		//Every level of detail halves the triangles of the one before it, they're added as meshes right after the full one
+		int AddMesh(const std::string& objPath, const VertexLayout& vertexLayout = VertexLayout::Full(), int maxNrLods = 4);
+		int AddTexture(const std::string& path);
+		int AddInstance(int meshIndex, int textureIndex, const Matrix& worldMatrix = {});
+
+		//Moving an instance only refits the hierarchy, adding one rebuilds it on the next query
+		void SetWorldMatrix(int instanceIndex, const Matrix& worldMatrix);
+		void SetOccluder(int instanceIndex, int occluderMeshIndex);
+		void SetMaterialMaps(int instanceIndex, int normalMapIndex, int specularMapIndex, int glossMapIndex);
+
+		//Instances whose world space box isn't completely outside the frustum, in the order they were added
+		void CullInstances(const Frustum& worldFrustum, std::vector<int>& visibleInstances);
+
+		//Closest instance the ray hits or -1, tested against the actual triangles
+		int Raycast(const Ray& ray, float& hitDistance);
+
+		std::vector<Mesh>& GetMeshes() { return m_Meshes; }
+		const std::vector<Mesh>& GetMeshes() const { return m_Meshes; }
+		const std::vector<MeshInstance>& GetInstances() const { return m_Instances; }
+		//Nullptr for -1, so maps an instance doesn't have can be looked up like any other
+		const Texture* GetTexture(int textureIndex) const { return textureIndex >= 0 ? m_pTextures[textureIndex] : nullptr; }
+		const BoundingBox& GetInstanceBounds(int instanceIndex) const { return m_InstanceBounds[instanceIndex]; }
+
+		//Goes up whenever a mesh, texture or instance is added or changed, the same version always draws the same frame
+		uint64_t GetVersion() const { return m_Version; }
+
+	private:
+		JobSystem* m_pJobSystem{};
+
+		std::vector<Mesh> m_Meshes{};
+		std::vector<Texture*> m_pTextures{};
+		std::vector<MeshInstance> m_Instances{};
+
+		//World space boxes of the instances, in the same order, and the hierarchy built over them
+		std::vector<BoundingBox> m_InstanceBounds{};
+		BVH m_Bvh{};
+		bool m_IsBvhOutdated{ false };
+		bool m_IsBvhRefitNeeded{ false };
+
+		uint64_t m_Version{};
+
+		void UpdateBvh();
+		static Mesh CreateMesh(std::vector<Vertex>&& vertices, std::vector<uint32_t>&& indices, const VertexLayout& vertexLayout);
+	};
+}
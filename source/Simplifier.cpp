@@ -0,0 +1,487 @@
+#include "Simplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace dae
+{
+	namespace
+	{
+		//Sum of the squared distances to a set of planes, each plane weighted by the area it came from
+		struct Quadric
+		{
+			double a00{}, a11{}, a22{}, a10{}, a20{}, a21{};
+			double b0{}, b1{}, b2{};
+			double c{};
+			double weight{};
+
+			//The normal has to be normalized
+			void AddPlane(const Vector3& normal, float distance, float planeWeight)
+			{
+				const double x{ normal.x }, y{ normal.y }, z{ normal.z }, d{ distance }, w{ planeWeight };
+				a00 += w * x * x;
+				a11 += w * y * y;
+				a22 += w * z * z;
+				a10 += w * y * x;
+				a20 += w * z * x;
+				a21 += w * z * y;
+				b0 += w * x * d;
+				b1 += w * y * d;
+				b2 += w * z * d;
+				c += w * d * d;
+				weight += w;
+			}
+
+			Quadric& operator+=(const Quadric& other)
+			{
+				a00 += other.a00; a11 += other.a11; a22 += other.a22;
+				a10 += other.a10; a20 += other.a20; a21 += other.a21;
+				b0 += other.b0; b1 += other.b1; b2 += other.b2;
+				c += other.c;
+				weight += other.weight;
+				return *this;
+			}
+
+			//Weighted mean of the squared distances
+			double Evaluate(const Vector3& point) const
+			{
+				if (weight <= 0.0)
+					return 0.0;
+
+				const double x{ point.x }, y{ point.y }, z{ point.z };
+				const double result{ a00 * x * x + a11 * y * y + a22 * z * z
+					+ 2.0 * (a10 * x * y + a20 * x * z + a21 * y * z)
+					+ 2.0 * (b0 * x + b1 * y + b2 * z) + c };
+				return std::abs(result) / weight;
+			}
+		};
+
+		//Vertices are welded on their exact bits, -0 gets folded into 0 first
+		struct VertexKey
+		{
+			uint32_t values[3]{};
+
+			bool operator==(const VertexKey& other) const
+			{
+				return std::memcmp(values, other.values, sizeof(values)) == 0;
+			}
+		};
+
+		struct VertexKeyHash
+		{
+			size_t operator()(const VertexKey& key) const
+			{
+				return (key.values[0] * 73856093u) ^ (key.values[1] * 19349663u) ^ (key.values[2] * 83492791u);
+			}
+		};
+
+		uint32_t GetBits(float value)
+		{
+			value += 0.f;
+			uint32_t bits{};
+			std::memcpy(&bits, &value, sizeof(bits));
+			return bits;
+		}
+
+		//Manifold vertices can move to any neighbour, border and seam vertices only along their border or seam, locked ones stay put
+		enum class VertexKind : uint8_t
+		{
+			manifold,
+			border,
+			seam,
+			locked
+		};
+
+		//Edge between two positions, the wedges are the ones the first triangle using the edge has at the lower and higher position
+		struct Edge
+		{
+			uint32_t nrTriangles{};
+			uint32_t triangle{};
+			uint32_t lowWedge{};
+			uint32_t highWedge{};
+			bool isSeam{};
+		};
+
+		struct Collapse
+		{
+			uint32_t from{};
+			uint32_t to{};
+			double error{};
+		};
+
+		uint64_t GetEdgeKey(uint32_t position0, uint32_t position1)
+		{
+			return (uint64_t(std::min(position0, position1)) << 32) | std::max(position0, position1);
+		}
+
+		constexpr uint32_t g_Unused{ UINT32_MAX };
+
+		//Borders and seams get pulled towards planes standing on them, so collapsing away from them is expensive
+		constexpr float g_FeatureWeight{ 4.f };
+
+		//A triangle may turn this far (cosine) when one of its corners moves
+		constexpr float g_MaxFlipCosine{ 0.25f };
+	}
+
+	float Simplifier::Simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetNrTriangles,
+		std::vector<Vertex>& verticesOut, std::vector<uint32_t>& indicesOut)
+	{
+		//Weld the corners, a wedge is a position with one set of texture coordinates
+		std::vector<Vector3> positions{};
+		std::vector<uint32_t> wedgePositions{};
+		std::vector<uint32_t> wedgeVertices{};
+		std::vector<uint32_t> vertexWedges(vertices.size());
+		{
+			std::unordered_map<VertexKey, uint32_t, VertexKeyHash> positionLookup{};
+			std::unordered_map<VertexKey, uint32_t, VertexKeyHash> wedgeLookup{};
+
+			for (uint32_t i{ 0 }; i < uint32_t(vertices.size()); ++i)
+			{
+				const Vertex& vertex{ vertices[i] };
+
+				const VertexKey positionKey{ { GetBits(vertex.position.x), GetBits(vertex.position.y), GetBits(vertex.position.z) } };
+				const auto positionIt{ positionLookup.try_emplace(positionKey, uint32_t(positions.size())).first };
+				if (positionIt->second == positions.size())
+					positions.push_back(vertex.position);
+
+				const VertexKey wedgeKey{ { positionIt->second, GetBits(vertex.uv.x), GetBits(vertex.uv.y) } };
+				const auto wedgeIt{ wedgeLookup.try_emplace(wedgeKey, uint32_t(wedgePositions.size())).first };
+				if (wedgeIt->second == wedgePositions.size())
+				{
+					wedgePositions.push_back(positionIt->second);
+					wedgeVertices.push_back(i);
+				}
+
+				vertexWedges[i] = wedgeIt->second;
+			}
+		}
+
+		std::vector<uint32_t> triangles{};
+		triangles.reserve(indices.size());
+		for (size_t i{ 0 }; i + 2 < indices.size(); i += 3)
+		{
+			const uint32_t wedges[3]{ vertexWedges[indices[i]], vertexWedges[indices[i + 1]], vertexWedges[indices[i + 2]] };
+			const uint32_t p0{ wedgePositions[wedges[0]] }, p1{ wedgePositions[wedges[1]] }, p2{ wedgePositions[wedges[2]] };
+			if (p0 == p1 || p1 == p2 || p2 == p0)
+				continue;
+
+			triangles.insert(triangles.end(), std::begin(wedges), std::end(wedges));
+		}
+
+		auto getPosition = [&](uint32_t wedge) { return wedgePositions[wedge]; };
+		auto getNormal = [&](const Vector3& p0, const Vector3& p1, const Vector3& p2) { return Vector3::Cross(p1 - p0, p2 - p0); };
+
+		std::unordered_map<uint64_t, Edge> edges{};
+		auto buildEdges = [&]()
+		{
+			edges.clear();
+			for (uint32_t triangle{ 0 }; triangle < uint32_t(triangles.size() / 3); ++triangle)
+			{
+				for (int corner{ 0 }; corner < 3; ++corner)
+				{
+					uint32_t wedge0{ triangles[triangle * 3 + corner] };
+					uint32_t wedge1{ triangles[triangle * 3 + (corner + 1) % 3] };
+					if (getPosition(wedge0) > getPosition(wedge1))
+						std::swap(wedge0, wedge1);
+
+					Edge& edge{ edges[GetEdgeKey(getPosition(wedge0), getPosition(wedge1))] };
+					if (edge.nrTriangles++ == 0)
+					{
+						edge.triangle = triangle;
+						edge.lowWedge = wedge0;
+						edge.highWedge = wedge1;
+					}
+					else if (edge.lowWedge != wedge0 || edge.highWedge != wedge1)
+						edge.isSeam = true;
+				}
+			}
+		};
+
+		//Plane of every triangle on its corners, and planes standing on the borders and seams
+		std::vector<Quadric> quadrics(positions.size());
+		for (size_t i{ 0 }; i < triangles.size(); i += 3)
+		{
+			const Vector3& p0{ positions[getPosition(triangles[i])] };
+			Vector3 normal{ getNormal(p0, positions[getPosition(triangles[i + 1])], positions[getPosition(triangles[i + 2])]) };
+			const float doubleArea{ normal.Normalize() };
+			if (doubleArea <= 0.f)
+				continue;
+
+			for (int corner{ 0 }; corner < 3; ++corner)
+				quadrics[getPosition(triangles[i + corner])].AddPlane(normal, -Vector3::Dot(normal, p0), doubleArea * 0.5f);
+		}
+
+		buildEdges();
+		for (const auto& [key, edge] : edges)
+		{
+			if (edge.nrTriangles != 1 && !edge.isSeam)
+				continue;
+
+			const uint32_t* pTriangle{ &triangles[edge.triangle * 3] };
+			Vector3 normal{ getNormal(positions[getPosition(pTriangle[0])], positions[getPosition(pTriangle[1])], positions[getPosition(pTriangle[2])]) };
+			if (normal.Normalize() <= 0.f)
+				continue;
+
+			const uint32_t position0{ uint32_t(key >> 32) }, position1{ uint32_t(key) };
+			const Vector3 direction{ positions[position1] - positions[position0] };
+			Vector3 planeNormal{ Vector3::Cross(direction, normal) };
+			if (planeNormal.Normalize() <= 0.f)
+				continue;
+
+			const float distance{ -Vector3::Dot(planeNormal, positions[position0]) };
+			quadrics[position0].AddPlane(planeNormal, distance, direction.SqrMagnitude() * g_FeatureWeight);
+			quadrics[position1].AddPlane(planeNormal, distance, direction.SqrMagnitude() * g_FeatureWeight);
+		}
+
+		size_t nrTriangles{ triangles.size() / 3 };
+		double maxError{ 0.0 };
+
+		std::vector<VertexKind> kinds(positions.size());
+		std::vector<uint32_t> firstWedges(positions.size());
+		std::vector<uint32_t> secondWedges(positions.size());
+		std::vector<uint8_t> nrBorderEdges(positions.size());
+		std::vector<uint8_t> nrSeamEdges(positions.size());
+		std::vector<uint8_t> isComplex(positions.size());
+		std::vector<uint32_t> adjacencyOffsets(positions.size() + 1);
+		std::vector<uint32_t> adjacency{};
+		std::vector<uint8_t> isTouched(positions.size());
+		std::vector<uint8_t> isRemoved{};
+		std::vector<Collapse> collapses{};
+		std::vector<std::pair<uint32_t, uint32_t>> wedgeMapping{};
+
+		//Every pass collapses a set of edges that don't share any triangles, cheapest first, and then rebuilds the connectivity
+		while (nrTriangles > targetNrTriangles)
+		{
+			buildEdges();
+
+			//Classify the positions
+			std::fill(firstWedges.begin(), firstWedges.end(), g_Unused);
+			std::fill(secondWedges.begin(), secondWedges.end(), g_Unused);
+			std::fill(nrBorderEdges.begin(), nrBorderEdges.end(), uint8_t(0));
+			std::fill(nrSeamEdges.begin(), nrSeamEdges.end(), uint8_t(0));
+			std::fill(isComplex.begin(), isComplex.end(), uint8_t(0));
+
+			for (uint32_t wedge : triangles)
+			{
+				const uint32_t position{ getPosition(wedge) };
+				if (firstWedges[position] == g_Unused)
+					firstWedges[position] = wedge;
+				else if (firstWedges[position] != wedge && secondWedges[position] == g_Unused)
+					secondWedges[position] = wedge;
+				else if (firstWedges[position] != wedge && secondWedges[position] != wedge)
+					isComplex[position] = 1;
+			}
+
+			for (const auto& [key, edge] : edges)
+			{
+				const uint32_t positionPair[2]{ uint32_t(key >> 32), uint32_t(key) };
+				for (uint32_t position : positionPair)
+				{
+					if (edge.nrTriangles > 2)
+						isComplex[position] = 1;
+					else if (edge.nrTriangles == 1)
+						nrBorderEdges[position] = uint8_t(std::min(nrBorderEdges[position] + 1, 255));
+					else if (edge.isSeam)
+						nrSeamEdges[position] = uint8_t(std::min(nrSeamEdges[position] + 1, 255));
+				}
+			}
+
+			for (size_t position{ 0 }; position < positions.size(); ++position)
+			{
+				const bool hasOneWedge{ secondWedges[position] == g_Unused };
+				const bool hasTwoWedges{ !hasOneWedge && !isComplex[position] };
+
+				if (isComplex[position])
+					kinds[position] = VertexKind::locked;
+				else if (nrBorderEdges[position] == 0 && nrSeamEdges[position] == 0)
+					kinds[position] = hasOneWedge ? VertexKind::manifold : VertexKind::locked;
+				else if (nrBorderEdges[position] == 2 && nrSeamEdges[position] == 0 && hasOneWedge)
+					kinds[position] = VertexKind::border;
+				else if (nrSeamEdges[position] == 2 && nrBorderEdges[position] == 0 && hasTwoWedges)
+					kinds[position] = VertexKind::seam;
+				else
+					kinds[position] = VertexKind::locked;
+			}
+
+			//Cheapest allowed direction of every edge
+			collapses.clear();
+			for (const auto& [key, edge] : edges)
+			{
+				auto isAllowed = [&](uint32_t from, uint32_t to)
+				{
+					switch (kinds[from])
+					{
+					case VertexKind::manifold: return true;
+					case VertexKind::border: return edge.nrTriangles == 1 && (kinds[to] == VertexKind::border || kinds[to] == VertexKind::locked);
+					case VertexKind::seam: return edge.isSeam && (kinds[to] == VertexKind::seam || kinds[to] == VertexKind::locked);
+					default: return false;
+					}
+				};
+
+				const uint32_t position0{ uint32_t(key >> 32) }, position1{ uint32_t(key) };
+				Collapse best{ 0, 0, -1.0 };
+				if (isAllowed(position0, position1))
+					best = { position0, position1, quadrics[position0].Evaluate(positions[position1]) };
+				if (isAllowed(position1, position0))
+				{
+					const double error{ quadrics[position1].Evaluate(positions[position0]) };
+					if (best.error < 0.0 || error < best.error)
+						best = { position1, position0, error };
+				}
+
+				if (best.error >= 0.0)
+					collapses.push_back(best);
+			}
+
+			if (collapses.empty())
+				break;
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+			//Each collapse takes about 2 triangles, edges a good bit more expensive than the ones needed are left for a later pass
+			const size_t nrCollapsesNeeded{ std::min((nrTriangles - targetNrTriangles + 1) / 2, collapses.size() - 1) };
+			const double errorLimit{ collapses[nrCollapsesNeeded].error * 1.5 };
+
+			//Triangles around every position
+			std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0u);
+			for (uint32_t wedge : triangles)
+				++adjacencyOffsets[getPosition(wedge) + 1];
+			for (size_t position{ 0 }; position < positions.size(); ++position)
+				adjacencyOffsets[position + 1] += adjacencyOffsets[position];
+			adjacency.resize(triangles.size());
+			{
+				std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+				for (uint32_t i{ 0 }; i < uint32_t(triangles.size()); ++i)
+					adjacency[fill[getPosition(triangles[i])]++] = i / 3;
+			}
+
+			std::fill(isTouched.begin(), isTouched.end(), uint8_t(0));
+			isRemoved.assign(triangles.size() / 3, 0);
+			bool hasCollapsed{ false };
+
+			for (const Collapse& collapse : collapses)
+			{
+				if (nrTriangles <= targetNrTriangles || collapse.error > errorLimit)
+					break;
+				if (isTouched[collapse.from] || isTouched[collapse.to])
+					continue;
+
+				const uint32_t firstAdjacent{ adjacencyOffsets[collapse.from] };
+				const uint32_t lastAdjacent{ adjacencyOffsets[collapse.from + 1] };
+
+				auto findCorner = [&](uint32_t triangle, uint32_t position)
+				{
+					for (int corner{ 0 }; corner < 3; ++corner)
+						if (getPosition(triangles[triangle * 3 + corner]) == position)
+							return corner;
+					return -1;
+				};
+
+				//The triangles on the edge tell which wedge of the kept position every wedge of the removed one turns into
+				wedgeMapping.clear();
+				bool isValid{ true };
+				for (uint32_t i{ firstAdjacent }; i < lastAdjacent && isValid; ++i)
+				{
+					const uint32_t triangle{ adjacency[i] };
+					const int toCorner{ findCorner(triangle, collapse.to) };
+					if (toCorner < 0)
+						continue;
+
+					const uint32_t fromWedge{ triangles[triangle * 3 + findCorner(triangle, collapse.from)] };
+					const uint32_t toWedge{ triangles[triangle * 3 + toCorner] };
+
+					const auto mappingIt{ std::find_if(wedgeMapping.begin(), wedgeMapping.end(), [fromWedge](const auto& mapping) { return mapping.first == fromWedge; }) };
+					if (mappingIt == wedgeMapping.end())
+						wedgeMapping.emplace_back(fromWedge, toWedge);
+					else
+						isValid = mappingIt->second == toWedge;
+				}
+
+				//The other triangles keep their corner, it only moves, none of them may fold over
+				for (uint32_t i{ firstAdjacent }; i < lastAdjacent && isValid; ++i)
+				{
+					const uint32_t triangle{ adjacency[i] };
+					if (findCorner(triangle, collapse.to) >= 0)
+						continue;
+
+					const int fromCorner{ findCorner(triangle, collapse.from) };
+					const uint32_t fromWedge{ triangles[triangle * 3 + fromCorner] };
+					if (std::none_of(wedgeMapping.begin(), wedgeMapping.end(), [fromWedge](const auto& mapping) { return mapping.first == fromWedge; }))
+					{
+						isValid = false;
+						break;
+					}
+
+					Vector3 corners[3]{};
+					for (int corner{ 0 }; corner < 3; ++corner)
+						corners[corner] = positions[getPosition(triangles[triangle * 3 + corner])];
+					const Vector3 normalBefore{ getNormal(corners[0], corners[1], corners[2]) };
+					corners[fromCorner] = positions[collapse.to];
+					const Vector3 normalAfter{ getNormal(corners[0], corners[1], corners[2]) };
+
+					if (Vector3::Dot(normalBefore, normalAfter) < g_MaxFlipCosine * normalBefore.Magnitude() * normalAfter.Magnitude())
+						isValid = false;
+				}
+
+				if (!isValid)
+					continue;
+
+				for (uint32_t i{ firstAdjacent }; i < lastAdjacent; ++i)
+				{
+					const uint32_t triangle{ adjacency[i] };
+					if (findCorner(triangle, collapse.to) >= 0)
+					{
+						isRemoved[triangle] = 1;
+						--nrTriangles;
+					}
+					else
+					{
+						uint32_t& wedge{ triangles[triangle * 3 + findCorner(triangle, collapse.from)] };
+						wedge = std::find_if(wedgeMapping.begin(), wedgeMapping.end(), [wedge](const auto& mapping) { return mapping.first == wedge; })->second;
+					}
+
+					//The neighbourhood changed, it waits for the next pass
+					for (int corner{ 0 }; corner < 3; ++corner)
+						isTouched[getPosition(triangles[triangle * 3 + corner])] = 1;
+				}
+				isTouched[collapse.from] = 1;
+
+				quadrics[collapse.to] += quadrics[collapse.from];
+				maxError = std::max(maxError, collapse.error);
+				hasCollapsed = true;
+			}
+
+			if (!hasCollapsed)
+				break;
+
+			size_t nrKept{ 0 };
+			for (size_t triangle{ 0 }; triangle < isRemoved.size(); ++triangle)
+			{
+				if (isRemoved[triangle])
+					continue;
+				std::copy_n(triangles.begin() + triangle * 3, 3, triangles.begin() + nrKept * 3);
+				++nrKept;
+			}
+			triangles.resize(nrKept * 3);
+		}
+
+		//Vertices in the order the triangles first use them, so meshlets end up with short vertex ranges
+		std::vector<uint32_t> wedgeRemap(wedgePositions.size(), g_Unused);
+		verticesOut.clear();
+		indicesOut.clear();
+		indicesOut.reserve(triangles.size());
+		for (uint32_t wedge : triangles)
+		{
+			if (wedgeRemap[wedge] == g_Unused)
+			{
+				wedgeRemap[wedge] = uint32_t(verticesOut.size());
+				verticesOut.push_back(vertices[wedgeVertices[wedge]]);
+			}
+			indicesOut.push_back(wedgeRemap[wedge]);
+		}
+
+		return float(std::sqrt(maxError));
+	}
+}
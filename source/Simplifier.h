@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	namespace Simplifier
+	{
+		//Quadric error edge collapse on a triangle list. Corners that share a position are welded first, so a triangle soup works as well.
+		//Every collapse moves a vertex onto one of its neighbours, the attributes of the kept vertices don't change.
+		//Open borders and texture seams only collapse along themselves and corners of them never move, so the outline and the uv layout hold.
+		//The output is indexed with the vertices in the order the triangles first use them.
+		//Returns how far (in object space) the result may be off from the input
+		float Simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetNrTriangles,
+			std::vector<Vertex>& verticesOut, std::vector<uint32_t>& indicesOut);
+	}
+}
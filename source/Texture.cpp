@@ -1,12 +1,16 @@
 #include "Texture.h"
 #include "Vector2.h"
 #include <SDL_image.h>
+#include <algorithm>
 
 namespace dae
 {
 	Texture::Texture(SDL_Surface* pSurface) :
 		m_pSurface{ pSurface },
-		m_pSurfacePixels{ (uint32_t*)pSurface->pixels }
+		m_pSurfacePixels{ (uint32_t*)pSurface->pixels },
+		m_RedShift{ pSurface->format->Rshift },
+		m_GreenShift{ pSurface->format->Gshift },
+		m_BlueShift{ pSurface->format->Bshift }
 	{
 	}
 
@@ -29,8 +33,9 @@ namespace dae
 	{
 		unsigned char r{}, g{}, b{};
 
-		const int x{ int(uv.x * m_pSurface->w) };
-		const int y{ int(uv.y * m_pSurface->h) };
+		//Interpolated coordinates can land a hair outside of 0..1 on the edges of a triangle
+		const int x{ std::clamp(int(uv.x * m_pSurface->w), 0, m_pSurface->w - 1) };
+		const int y{ std::clamp(int(uv.y * m_pSurface->h), 0, m_pSurface->h - 1) };
 
 		unsigned const int pixel{ m_pSurfacePixels[x + y * m_pSurface->w] };
 
@@ -40,4 +45,29 @@ namespace dae
 
 		return { r * inverseClampedValue, g * inverseClampedValue, b * inverseClampedValue };
 	}
+
+	void Texture::SampleQuad(const Vector2 uvs[4], __m128& red, __m128& green, __m128& blue) const
+	{
+		//Split the pairs into one register of us and one of vs
+		const __m128 first{ _mm_loadu_ps(&uvs[0].x) };
+		const __m128 second{ _mm_loadu_ps(&uvs[2].x) };
+		const __m128 u{ _mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0)) };
+		const __m128 v{ _mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1)) };
+
+		const __m128i zero{ _mm_setzero_si128() };
+		const __m128i x{ _mm_min_epi32(_mm_max_epi32(_mm_cvttps_epi32(_mm_mul_ps(u, _mm_set1_ps(float(m_pSurface->w)))), zero), _mm_set1_epi32(m_pSurface->w - 1)) };
+		const __m128i y{ _mm_min_epi32(_mm_max_epi32(_mm_cvttps_epi32(_mm_mul_ps(v, _mm_set1_ps(float(m_pSurface->h)))), zero), _mm_set1_epi32(m_pSurface->h - 1)) };
+
+		alignas(16) int texelIndices[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(texelIndices), _mm_add_epi32(x, _mm_mullo_epi32(y, _mm_set1_epi32(m_pSurface->w))));
+
+		const __m128i texels{ _mm_setr_epi32(int(m_pSurfacePixels[texelIndices[0]]), int(m_pSurfacePixels[texelIndices[1]]),
+			int(m_pSurfacePixels[texelIndices[2]]), int(m_pSurfacePixels[texelIndices[3]])) };
+
+		const __m128i channelMask{ _mm_set1_epi32(0xFF) };
+		const __m128 scale{ _mm_set1_ps(1 / 255.f) };
+		red = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srl_epi32(texels, _mm_cvtsi32_si128(m_RedShift)), channelMask)), scale);
+		green = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srl_epi32(texels, _mm_cvtsi32_si128(m_GreenShift)), channelMask)), scale);
+		blue = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srl_epi32(texels, _mm_cvtsi32_si128(m_BlueShift)), channelMask)), scale);
+	}
 }
\ No newline at end of file
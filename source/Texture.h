@@ -1,5 +1,6 @@
 #pragma once
 #include <SDL_surface.h>
+#include <immintrin.h>
 #include <string>
 #include "ColorRGB.h"
 
@@ -15,10 +16,18 @@ namespace dae
 		static Texture* LoadFromFile(const std::string& path);
 		ColorRGB Sample(const Vector2& uv) const;
 
+		//Same as Sample for 4 uvs at once, every channel of the 4 texels ends up in a register of its own
+		void SampleQuad(const Vector2 uvs[4], __m128& red, __m128& green, __m128& blue) const;
+
 	private:
 		Texture(SDL_Surface* pSurface);
 
 		SDL_Surface* m_pSurface{ nullptr };
 		uint32_t* m_pSurfacePixels{ nullptr };
+
+		//Where the channels are in a texel, so SampleQuad can unpack them without SDL_GetRGB
+		int m_RedShift{};
+		int m_GreenShift{};
+		int m_BlueShift{};
 	};
 }
\ No newline at end of file
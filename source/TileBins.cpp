@@ -0,0 +1,111 @@
+#include "TileBins.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "FrameArena.h"
+
+namespace dae
+{
+	TileBins::TileBins(int nrTiles, int nrThreads) :
+		m_NrTiles{ nrTiles },
+		m_ThreadBatches(nrThreads)
+	{
+		for (ThreadBatch& batch : m_ThreadBatches)
+		{
+			batch.pLists = new List[nrTiles]{};
+			batch.pTouchedTileMask = new uint64_t[(nrTiles + 63) / 64]{};
+			batch.pTileCounts = new int[nrTiles]{};
+		}
+	}
+
+	TileBins::~TileBins()
+	{
+		for (ThreadBatch& batch : m_ThreadBatches)
+		{
+			delete[] batch.pLists;
+			delete[] batch.pTouchedTileMask;
+			delete[] batch.pTileCounts;
+		}
+	}
+
+	void TileBins::Reset(int nrBatches, FrameArena& arena)
+	{
+		m_NrBatches = nrBatches;
+		m_pBatches = arena.Allocate<Batch>(nrBatches);
+		m_pTileStarts = nullptr;
+		m_pTileLists = nullptr;
+	}
+
+	void TileBins::EndBatch(int threadIndex, int batchIndex, FrameArena& arena)
+	{
+		ThreadBatch& threadBatch{ m_ThreadBatches[threadIndex] };
+
+		//Going through the mask puts the tiles in order, so Gather can find where its range of tiles starts
+		TileList* pTileLists{ arena.Allocate<TileList>(threadBatch.nrTouchedTiles) };
+		int nrTileLists{ 0 };
+		for (int word{ 0 }; word < (m_NrTiles + 63) / 64; ++word)
+		{
+			for (uint64_t tileBits{ threadBatch.pTouchedTileMask[word] }; tileBits; tileBits &= tileBits - 1)
+			{
+				const int tileIndex{ word * 64 + std::countr_zero(tileBits) };
+				pTileLists[nrTileLists++] = { tileIndex, threadBatch.pLists[tileIndex] };
+				threadBatch.pLists[tileIndex] = {};
+				++threadBatch.pTileCounts[tileIndex];
+			}
+			threadBatch.pTouchedTileMask[word] = 0;
+		}
+
+		m_pBatches[batchIndex] = { pTileLists, nrTileLists };
+		threadBatch.nrTouchedTiles = 0;
+	}
+
+	void TileBins::Finish(FrameArena& arena)
+	{
+		//Every tile gets a range of its own from what the threads counted, the counts start over for the next frame
+		m_pTileStarts = arena.Allocate<int>(size_t(m_NrTiles) + 1);
+		m_pTileStarts[0] = 0;
+		for (int tileIndex{ 0 }; tileIndex < m_NrTiles; ++tileIndex)
+		{
+			int nrLists{ 0 };
+			for (ThreadBatch& threadBatch : m_ThreadBatches)
+			{
+				nrLists += threadBatch.pTileCounts[tileIndex];
+				threadBatch.pTileCounts[tileIndex] = 0;
+			}
+			m_pTileStarts[tileIndex + 1] = m_pTileStarts[tileIndex] + nrLists;
+		}
+
+		m_pTileLists = arena.Allocate<const List*>(m_pTileStarts[m_NrTiles]);
+		m_pNextLists = arena.Allocate<int>(m_NrTiles);
+		std::copy_n(m_pTileStarts, m_NrTiles, m_pNextLists);
+	}
+
+	void TileBins::Gather(int firstTile, int lastTile)
+	{
+		//Going through the batches in order puts the lists of every tile in batch order
+		for (int batchIndex{ 0 }; batchIndex < m_NrBatches; ++batchIndex)
+		{
+			const Batch& batch{ m_pBatches[batchIndex] };
+			const TileList* pEnd{ batch.pTileLists + batch.nrTileLists };
+			const TileList* pTileList{ std::lower_bound(batch.pTileLists, pEnd, firstTile,
+				[](const TileList& tileList, int tileIndex) { return tileList.tileIndex < tileIndex; }) };
+
+			for (; pTileList != pEnd && pTileList->tileIndex < lastTile; ++pTileList)
+				m_pTileLists[m_pNextLists[pTileList->tileIndex]++] = &pTileList->list;
+		}
+	}
+
+	void TileBins::AddChunk(List& list, FrameArena& arena)
+	{
+		Chunk* pChunk{ arena.Allocate<Chunk>(1) };
+		pChunk->pNext = nullptr;
+		pChunk->nrTriangles = 0;
+
+		if (list.pLast)
+			list.pLast->pNext = pChunk;
+		else
+			list.pFirst = pChunk;
+		list.pLast = pChunk;
+	}
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace dae
+{
+	class FrameArena;
+
+	//A triangle that touches a tile, by the draw call it belongs to and its first index
+	struct BinnedTriangle
+	{
+		uint32_t drawIndex{};
+		uint32_t firstIndex{};
+	};
+
+	//Triangles per screen tile, filled by several threads at once without locks or atomics.
+	//Binning is split in batches of consecutive triangles that each belong to one job. While a thread bins a batch its lists live in
+	//storage of that thread, once the batch is done the lists of the tiles it touched are copied out to a compact array of the batch.
+	//Finish gathers those into the lists of every tile in batch order, which gives the triangles back in the order they were submitted
+	//whichever thread binned them. Only touched tiles of a batch take up memory, nothing costs tiles times batches
+	class TileBins final
+	{
+	public:
+		TileBins(int nrTiles, int nrThreads);
+		~TileBins();
+
+		TileBins(const TileBins&) = delete;
+		TileBins(TileBins&&) noexcept = delete;
+		TileBins& operator=(const TileBins&) = delete;
+		TileBins& operator=(TileBins&&) noexcept = delete;
+
+		//Empties every tile and makes room for the batches of the next frame.
+		//Lists and triangles come out of the arena, so they're gone once it's reset
+		void Reset(int nrBatches, FrameArena& arena);
+
+		//Adds to the batch the calling thread is binning, triangles have to come in the order they were submitted.
+		//A thread bins one batch at a time, EndBatch hands it over before the thread can start on the next one
+		void Add(int threadIndex, int tileIndex, const BinnedTriangle& triangle, FrameArena& arena)
+		{
+			ThreadBatch& batch{ m_ThreadBatches[threadIndex] };
+			List& list{ batch.pLists[tileIndex] };
+			if (!list.pLast)
+			{
+				batch.pTouchedTileMask[tileIndex / 64] |= uint64_t(1) << (tileIndex % 64);
+				++batch.nrTouchedTiles;
+			}
+
+			if (!list.pLast || list.pLast->nrTriangles == Chunk::capacity)
+				AddChunk(list, arena);
+
+			list.pLast->triangles[list.pLast->nrTriangles++] = triangle;
+		}
+
+		//Stores what the calling thread binned as the batch, and leaves the thread with no tiles touched for its next one
+		void EndBatch(int threadIndex, int batchIndex, FrameArena& arena);
+
+		//Once all batches are binned, makes room for the lists every tile got. Gather fills that room in
+		void Finish(FrameArena& arena);
+		//Turns the tiles every batch touched into the batches every tile has, for the tiles from firstTile up to lastTile.
+		//Ranges that don't overlap can be gathered at the same time, nothing can be read before all tiles are
+		void Gather(int firstTile, int lastTile);
+
+		bool IsEmpty(int tileIndex) const { return m_pTileStarts[tileIndex] == m_pTileStarts[tileIndex + 1]; }
+
+		//Calls the function for every triangle of the tile in submission order
+		template<typename Function>
+		void ForEach(int tileIndex, const Function& function) const
+		{
+			for (int listIndex{ m_pTileStarts[tileIndex] }; listIndex < m_pTileStarts[tileIndex + 1]; ++listIndex)
+				for (const Chunk* pChunk{ m_pTileLists[listIndex]->pFirst }; pChunk; pChunk = pChunk->pNext)
+					for (uint32_t i{ 0 }; i < pChunk->nrTriangles; ++i)
+						function(pChunk->triangles[i]);
+		}
+
+		int GetNrTiles() const { return m_NrTiles; }
+
+	private:
+		//512 bytes, a few cache lines the writing thread fills on its own
+		struct Chunk
+		{
+			static constexpr uint32_t capacity{ 62 };
+
+			Chunk* pNext{};
+			uint32_t nrTriangles{};
+			BinnedTriangle triangles[capacity];
+		};
+
+		struct List
+		{
+			Chunk* pFirst{};
+			Chunk* pLast{};
+		};
+
+		struct TileList
+		{
+			int tileIndex{};
+			List list{};
+		};
+
+		//The tiles a batch touched and their lists sorted by tile, written once by the job that binned it
+		struct Batch
+		{
+			const TileList* pTileLists{};
+			int nrTileLists{};
+		};
+
+		//The batch a thread is binning, padded so no two threads ever write to the same cache line.
+		//A tile whose list has no chunk hasn't been touched by the batch yet, the mask has a bit for each one that has.
+		//The lists every tile got from the batches the thread binned are counted as well, so Finish only has to add up the threads
+		struct alignas(64) ThreadBatch
+		{
+			List* pLists{};
+			uint64_t* pTouchedTileMask{};
+			int nrTouchedTiles{};
+			int* pTileCounts{};
+		};
+
+		int m_NrTiles{};
+		int m_NrBatches{};
+		std::vector<ThreadBatch> m_ThreadBatches{};
+
+		Batch* m_pBatches{};
+
+		//The lists of tile i are m_pTileLists[m_pTileStarts[i]] up to m_pTileLists[m_pTileStarts[i + 1]], in batch order. Filled by Gather
+		int* m_pTileStarts{};
+		const List** m_pTileLists{};
+		//Where Gather puts the next list of every tile
+		int* m_pNextLists{};
+
+		void AddChunk(List& list, FrameArena& arena);
+	};
+}
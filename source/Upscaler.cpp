@@ -0,0 +1,152 @@
+#include "Upscaler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <immintrin.h>
+
+#include "JobSystem.h"
+
+namespace dae
+{
+	namespace
+	{
+		//Weights are 6 bit so two of them times a channel still fit the 16 bit sums of _mm_maddubs_epi16
+		constexpr int g_WeightBits{ 6 };
+		constexpr int g_WeightOne{ 1 << g_WeightBits };
+
+		//Left source pixel and weight of the right one for every destination pixel, pixel centers line up at both ends
+		void GetSamples(int sourceSize, int destinationSize, int destinationIndex, int& first, int& weight)
+		{
+			const float position{ (destinationIndex + 0.5f) * sourceSize / destinationSize - 0.5f };
+			first = int(std::floor(position));
+			weight = int((position - first) * g_WeightOne + 0.5f);
+
+			//Past the edges the outermost pixel is repeated, both taps stay inside the image
+			if (first < 0)
+			{
+				first = 0;
+				weight = 0;
+			}
+			else if (first >= sourceSize - 1)
+			{
+				first = sourceSize - 2;
+				weight = g_WeightOne;
+			}
+		}
+	}
+
+	Upscaler::Upscaler(JobSystem* pJobSystem) :
+		m_pJobSystem{ pJobSystem }
+	{
+	}
+
+	void Upscaler::Upscale(const uint32_t* pSource, int sourceWidth, int sourceHeight, uint32_t* pDestination, int destinationWidth, int destinationHeight)
+	{
+		assert(sourceWidth >= 2 && sourceHeight >= 2 && "Bilinear filtering needs two pixels in both directions");
+
+		if (sourceWidth != m_SourceWidth || sourceHeight != m_SourceHeight ||
+			destinationWidth != m_DestinationWidth || destinationHeight != m_DestinationHeight)
+			BuildTables(sourceWidth, sourceHeight, destinationWidth, destinationHeight);
+
+		m_pJobSystem->ParallelFor(destinationHeight, 16, [this, pSource, pDestination](size_t first, size_t last)
+			{
+				for (size_t y{ first }; y < last; ++y)
+					UpscaleRow(pSource, pDestination + y * m_DestinationWidth, int(y));
+			});
+	}
+
+	void Upscaler::BuildTables(int sourceWidth, int sourceHeight, int destinationWidth, int destinationHeight)
+	{
+		m_SourceWidth = sourceWidth;
+		m_SourceHeight = sourceHeight;
+		m_DestinationWidth = destinationWidth;
+		m_DestinationHeight = destinationHeight;
+
+		m_SourceColumns.resize(destinationWidth);
+		m_ColumnWeights.resize(destinationWidth);
+		for (int x{ 0 }; x < destinationWidth; ++x)
+		{
+			int weight{};
+			GetSamples(sourceWidth, destinationWidth, x, m_SourceColumns[x], weight);
+
+			//Matches the order of the interleaved pixel pair, left then right for every channel
+			const uint64_t pair{ uint64_t(g_WeightOne - weight) | uint64_t(weight) << 8 };
+			m_ColumnWeights[x] = pair * 0x0001000100010001ull;
+		}
+
+		m_SourceRows.resize(destinationHeight);
+		m_RowWeights.resize(destinationHeight);
+		for (int y{ 0 }; y < destinationHeight; ++y)
+		{
+			int weight{};
+			GetSamples(sourceHeight, destinationHeight, y, m_SourceRows[y], weight);
+			m_RowWeights[y] = uint8_t(weight);
+		}
+	}
+
+	void Upscaler::UpscaleRow(const uint32_t* pSource, uint32_t* pDestination, int destinationY) const
+	{
+		const uint32_t* pRow0{ pSource + size_t(m_SourceRows[destinationY]) * m_SourceWidth };
+		const uint32_t* pRow1{ pRow0 + m_SourceWidth };
+		const int rowWeight{ m_RowWeights[destinationY] };
+
+		int x{ 0 };
+
+#ifdef __AVX__
+		//Two neighbouring source pixels are loaded as one 64 bit value and their channels interleaved,
+		//then _mm_maddubs_epi16 does left * (64 - w) + right * w for every channel at once
+		const __m128i interleave{ _mm_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15) };
+		const __m128i rounding{ _mm_set1_epi16(g_WeightOne / 2) };
+		const __m128i rowWeights{ _mm_set1_epi16(short((g_WeightOne - rowWeight) | rowWeight << 8)) };
+
+		auto filterHorizontally = [&](const uint32_t* pRow, int firstX)
+		{
+			auto filterPair = [&](int pairX)
+			{
+				const __m128i left{ _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pRow + m_SourceColumns[pairX])) };
+				const __m128i right{ _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pRow + m_SourceColumns[pairX + 1])) };
+				const __m128i pixels{ _mm_shuffle_epi8(_mm_unpacklo_epi64(left, right), interleave) };
+				const __m128i weights{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_ColumnWeights.data() + pairX)) };
+				return _mm_srli_epi16(_mm_add_epi16(_mm_maddubs_epi16(pixels, weights), rounding), g_WeightBits);
+			};
+			return _mm_packus_epi16(filterPair(firstX), filterPair(firstX + 2));
+		};
+
+		for (; x + 4 <= m_DestinationWidth; x += 4)
+		{
+			const __m128i top{ filterHorizontally(pRow0, x) };
+			const __m128i bottom{ filterHorizontally(pRow1, x) };
+
+			const __m128i low{ _mm_maddubs_epi16(_mm_unpacklo_epi8(top, bottom), rowWeights) };
+			const __m128i high{ _mm_maddubs_epi16(_mm_unpackhi_epi8(top, bottom), rowWeights) };
+			const __m128i result{ _mm_packus_epi16(
+				_mm_srli_epi16(_mm_add_epi16(low, rounding), g_WeightBits),
+				_mm_srli_epi16(_mm_add_epi16(high, rounding), g_WeightBits)) };
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + x), result);
+		}
+#endif
+
+		//Same rounding as the SIMD version, so the last few pixels of a row don't stand out
+		for (; x < m_DestinationWidth; ++x)
+		{
+			const int sourceX{ m_SourceColumns[x] };
+			const int columnWeight{ int(m_ColumnWeights[x] >> 8 & 0xFF) };
+
+			uint32_t result{ 0 };
+			for (int shift{ 0 }; shift < 32; shift += 8)
+			{
+				auto filter = [&](const uint32_t* pRow)
+				{
+					const int left{ int(pRow[sourceX] >> shift & 0xFF) };
+					const int right{ int(pRow[sourceX + 1] >> shift & 0xFF) };
+					return (left * (g_WeightOne - columnWeight) + right * columnWeight + g_WeightOne / 2) >> g_WeightBits;
+				};
+				const int value{ (filter(pRow0) * (g_WeightOne - rowWeight) + filter(pRow1) * rowWeight + g_WeightOne / 2) >> g_WeightBits };
+				result |= uint32_t(value) << shift;
+			}
+			pDestination[x] = result;
+		}
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace dae
+{
+	class JobSystem;
+
+	//Bilinear upscale of a low resolution frame onto the back buffer, used when rendering below the output resolution.
+	//The filter tables are rebuilt only when one of the sizes changes, rows are spread over the job system
+	class Upscaler final
+	{
+	public:
+		explicit Upscaler(JobSystem* pJobSystem);
+
+		//Both images are 32 bits per pixel with the same channel order, every channel is filtered the same way.
+		//The source has to be at least 2x2 and its rows are packed, sourceWidth pixels apart
+		void Upscale(const uint32_t* pSource, int sourceWidth, int sourceHeight, uint32_t* pDestination, int destinationWidth, int destinationHeight);
+
+	private:
+		JobSystem* m_pJobSystem{};
+
+		int m_SourceWidth{};
+		int m_SourceHeight{};
+		int m_DestinationWidth{};
+		int m_DestinationHeight{};
+
+		//Per destination column the left one of the two source pixels, and 8 bytes of weights: 64 - w and w for every channel
+		std::vector<int> m_SourceColumns{};
+		std::vector<uint64_t> m_ColumnWeights{};
+
+		//Per destination row the upper one of the two source rows and the weight of the lower one, out of 64
+		std::vector<int> m_SourceRows{};
+		std::vector<uint8_t> m_RowWeights{};
+
+		void BuildTables(int sourceWidth, int sourceHeight, int destinationWidth, int destinationHeight);
+		void UpscaleRow(const uint32_t* pSource, uint32_t* pDestination, int destinationY) const;
+	};
+}
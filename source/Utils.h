@@ -146,7 +146,11 @@ namespace dae
 				const Vector3 edge1 = p2 - p0;
 				const Vector2 diffX = Vector2(uv1.x - uv0.x, uv2.x - uv0.x);
 				const Vector2 diffY = Vector2(uv1.y - uv0.y, uv2.y - uv0.y);
-				float r = 1.f / Vector2::Cross(diffX, diffY);
+				const float uvArea = Vector2::Cross(diffX, diffY);
+
+				//Without any area in uv space there's no direction the tangent follows
+				if (uvArea == 0.f) continue;
+				float r = 1.f / uvArea;
 
 				Vector3 tangent = (edge0 * diffY.y - edge1 * diffY.x) * r;
 				vertices[index0].tangent += tangent;
@@ -157,7 +161,12 @@ namespace dae
 			//Fix the tangents per vertex now because we accumulated
 			for (auto& v : vertices)
 			{
-				v.tangent = Vector3::Reject(v.tangent, v.normal).Normalized();
+				v.tangent = Vector3::Reject(v.tangent, v.normal);
+
+				//Only touched by triangles without uv area, any direction along the surface will do
+				if (v.tangent.SqrMagnitude() < 1e-12f)
+					v.tangent = Vector3::Reject(std::abs(v.normal.x) < .9f ? Vector3::UnitX : Vector3::UnitY, v.normal);
+				v.tangent.Normalize();
 
 				if(flipAxisAndWinding)
 				{
@@ -26,6 +26,8 @@ namespace dae
 		static Vector3 Reject(const Vector3& v1, const Vector3& v2);
 		static Vector3 Reflect(const Vector3& v1, const Vector3& v2);
 		static Vector3 Lico(float f1, const Vector3& v1, float f2, const Vector3& v2, float f3, const Vector3& v3);
+		static Vector3 Min(const Vector3& v1, const Vector3& v2);
+		static Vector3 Max(const Vector3& v1, const Vector3& v2);
 
 		Vector4 ToPoint4() const;
 		Vector4 ToVector4() const;
@@ -1,6 +1,7 @@
 #include "Vector4.h"
 
 #include <cassert>
+#include <xmmintrin.h>
 
 #include "Vector2.h"
 #include "Vector3.h"
@@ -56,25 +57,28 @@ namespace dae
 #pragma region Operator Overloads
 	Vector4 Vector4::operator*(float scale) const
 	{
-		return { x * scale, y * scale, z * scale, w * scale };
+		Vector4 result;
+		_mm_store_ps(&result.x, _mm_mul_ps(_mm_load_ps(&x), _mm_set1_ps(scale)));
+		return result;
 	}
 
 	Vector4 Vector4::operator+(const Vector4& v) const
 	{
-		return { x + v.x, y + v.y, z + v.z, w + v.w };
+		Vector4 result;
+		_mm_store_ps(&result.x, _mm_add_ps(_mm_load_ps(&x), _mm_load_ps(&v.x)));
+		return result;
 	}
 
 	Vector4 Vector4::operator-(const Vector4& v) const
 	{
-		return { x - v.x, y - v.y, z - v.z, w - v.w };
+		Vector4 result;
+		_mm_store_ps(&result.x, _mm_sub_ps(_mm_load_ps(&x), _mm_load_ps(&v.x)));
+		return result;
 	}
 
 	Vector4& Vector4::operator+=(const Vector4& v)
 	{
-		x += v.x;
-		y += v.y;
-		z += v.z;
-		w += v.w;
+		_mm_store_ps(&x, _mm_add_ps(_mm_load_ps(&x), _mm_load_ps(&v.x)));
 		return *this;
 	}
 
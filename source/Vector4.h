@@ -4,7 +4,8 @@ namespace dae
 {
 	struct Vector2;
 	struct Vector3;
-	struct Vector4
+	//Aligned so it can be loaded straight into an SSE register
+	struct alignas(16) Vector4
 	{
 		float x;
 		float y;
@@ -0,0 +1,299 @@
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	namespace
+	{
+		size_t GetTexCoordSize(TexCoordFormat format)
+		{
+			return format == TexCoordFormat::Float2 ? 2 * sizeof(float) : 2 * sizeof(uint16_t);
+		}
+
+		size_t GetDirectionSize(DirectionFormat format)
+		{
+			switch (format)
+			{
+			case DirectionFormat::Float3:
+				return 3 * sizeof(float);
+			case DirectionFormat::Octahedral16:
+				return 2 * sizeof(int16_t);
+			default:
+				return 0;
+			}
+		}
+
+		void PackDirection(const Vector3& direction, DirectionFormat format, uint8_t* pDestination)
+		{
+			if (format == DirectionFormat::Float3)
+			{
+				const float values[3]{ direction.x, direction.y, direction.z };
+				std::memcpy(pDestination, values, sizeof(values));
+			}
+			else if (format == DirectionFormat::Octahedral16)
+			{
+				int16_t values[2]{};
+				VertexFormat::EncodeOctahedral(direction, values[0], values[1]);
+				std::memcpy(pDestination, values, sizeof(values));
+			}
+		}
+
+		Vector3 UnpackDirection(const std::vector<uint8_t>& stream, DirectionFormat format, size_t index)
+		{
+			const uint8_t* pSource{ stream.data() + index * GetDirectionSize(format) };
+
+			if (format == DirectionFormat::Float3)
+			{
+				float values[3]{};
+				std::memcpy(values, pSource, sizeof(values));
+				return { values[0], values[1], values[2] };
+			}
+			if (format == DirectionFormat::Octahedral16)
+			{
+				int16_t values[2]{};
+				std::memcpy(values, pSource, sizeof(values));
+				return VertexFormat::DecodeOctahedral(values[0], values[1]);
+			}
+			return {};
+		}
+
+		int16_t ToSnorm16(float value)
+		{
+			return int16_t(std::round(std::clamp(value, -1.f, 1.f) * 32767.f));
+		}
+
+		float FromSnorm16(int16_t value)
+		{
+			return std::max(value / 32767.f, -1.f);
+		}
+	}
+
+	size_t VertexLayout::GetVertexSize() const
+	{
+		return 3 * sizeof(float) + GetTexCoordSize(texCoord) + GetDirectionSize(normal) + GetDirectionSize(tangent);
+	}
+
+	namespace VertexFormat
+	{
+		uint16_t FloatToHalf(float value)
+		{
+			uint32_t bits{};
+			std::memcpy(&bits, &value, sizeof(bits));
+
+			const uint16_t sign{ uint16_t((bits >> 16) & 0x8000) };
+			const int floatExponent{ int((bits >> 23) & 0xff) };
+			uint32_t mantissa{ bits & 0x7fffff };
+
+			//Infinity stays infinity, NaN stays NaN
+			if (floatExponent == 0xff)
+				return uint16_t(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+
+			const int exponent{ floatExponent - 127 + 15 };
+			if (exponent >= 31)
+				return uint16_t(sign | 0x7c00);
+
+			if (exponent <= 0)
+			{
+				//Too small even for a denormal
+				if (exponent < -10)
+					return sign;
+
+				mantissa |= 0x800000;
+				const int shift{ 14 - exponent };
+				uint32_t half{ mantissa >> shift };
+				const uint32_t remainder{ mantissa & ((1u << shift) - 1) };
+				const uint32_t halfway{ 1u << (shift - 1) };
+				if (remainder > halfway || (remainder == halfway && (half & 1)))
+					++half;
+				return uint16_t(sign | half);
+			}
+
+			//Round to nearest even, a carry out of the mantissa correctly bumps the exponent
+			uint32_t half{ uint32_t(exponent << 10) | (mantissa >> 13) };
+			const uint32_t remainder{ mantissa & 0x1fff };
+			if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+				++half;
+			return uint16_t(sign | half);
+		}
+
+		float HalfToFloat(uint16_t value)
+		{
+			const uint32_t sign{ uint32_t(value & 0x8000) << 16 };
+			int exponent{ (value >> 10) & 0x1f };
+			uint32_t mantissa{ uint32_t(value & 0x3ff) };
+
+			uint32_t bits{};
+			if (exponent == 0)
+			{
+				if (mantissa == 0)
+					bits = sign;
+				else
+				{
+					//Denormal, shift until the implicit bit shows up
+					exponent = 1;
+					while (!(mantissa & 0x400))
+					{
+						mantissa <<= 1;
+						--exponent;
+					}
+					mantissa &= 0x3ff;
+					bits = sign | (uint32_t(exponent + 127 - 15) << 23) | (mantissa << 13);
+				}
+			}
+			else if (exponent == 31)
+				bits = sign | 0x7f800000 | (mantissa << 13);
+			else
+				bits = sign | (uint32_t(exponent + 127 - 15) << 23) | (mantissa << 13);
+
+			float result{};
+			std::memcpy(&result, &bits, sizeof(result));
+			return result;
+		}
+
+		void EncodeOctahedral(const Vector3& direction, int16_t& x, int16_t& y)
+		{
+			const float length{ std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z) };
+			if (length <= 0.f)
+			{
+				x = y = 0;
+				return;
+			}
+
+			float octX{ direction.x / length };
+			float octY{ direction.y / length };
+
+			//The lower half gets folded over the diagonals
+			if (direction.z < 0.f)
+			{
+				const float foldedX{ (1.f - std::abs(octY)) * (octX >= 0.f ? 1.f : -1.f) };
+				const float foldedY{ (1.f - std::abs(octX)) * (octY >= 0.f ? 1.f : -1.f) };
+				octX = foldedX;
+				octY = foldedY;
+			}
+
+			x = ToSnorm16(octX);
+			y = ToSnorm16(octY);
+		}
+
+		Vector3 DecodeOctahedral(int16_t x, int16_t y)
+		{
+			float octX{ FromSnorm16(x) };
+			float octY{ FromSnorm16(y) };
+			const float z{ 1.f - std::abs(octX) - std::abs(octY) };
+
+			const float fold{ std::max(-z, 0.f) };
+			octX += octX >= 0.f ? -fold : fold;
+			octY += octY >= 0.f ? -fold : fold;
+
+			return Vector3{ octX, octY, z }.Normalized();
+		}
+
+		void PackAttributes(const std::vector<Vertex>& vertices, const VertexLayout& layout, PackedAttributes& attributes)
+		{
+			const size_t nrVertices{ vertices.size() };
+			attributes.layout = layout;
+			attributes.nrVertices = nrVertices;
+
+			attributes.texCoordMin = {};
+			attributes.texCoordRange = { 1.f, 1.f };
+			if (layout.texCoord == TexCoordFormat::Unorm16x2 && nrVertices > 0)
+			{
+				Vector2 min{ vertices[0].uv };
+				Vector2 max{ vertices[0].uv };
+				for (const Vertex& vertex : vertices)
+				{
+					min.x = std::min(min.x, vertex.uv.x);
+					min.y = std::min(min.y, vertex.uv.y);
+					max.x = std::max(max.x, vertex.uv.x);
+					max.y = std::max(max.y, vertex.uv.y);
+				}
+				attributes.texCoordMin = min;
+				attributes.texCoordRange = { max.x > min.x ? max.x - min.x : 1.f, max.y > min.y ? max.y - min.y : 1.f };
+			}
+
+			const size_t texCoordSize{ GetTexCoordSize(layout.texCoord) };
+			const size_t normalSize{ GetDirectionSize(layout.normal) };
+			const size_t tangentSize{ GetDirectionSize(layout.tangent) };
+			attributes.texCoords.assign(nrVertices * texCoordSize, 0);
+			attributes.normals.assign(nrVertices * normalSize, 0);
+			attributes.tangents.assign(nrVertices * tangentSize, 0);
+
+			for (size_t i{ 0 }; i < nrVertices; ++i)
+			{
+				const Vertex& vertex{ vertices[i] };
+				uint8_t* pTexCoord{ attributes.texCoords.data() + i * texCoordSize };
+
+				switch (layout.texCoord)
+				{
+				case TexCoordFormat::Float2:
+				{
+					const float values[2]{ vertex.uv.x, vertex.uv.y };
+					std::memcpy(pTexCoord, values, sizeof(values));
+					break;
+				}
+				case TexCoordFormat::Half2:
+				{
+					const uint16_t values[2]{ FloatToHalf(vertex.uv.x), FloatToHalf(vertex.uv.y) };
+					std::memcpy(pTexCoord, values, sizeof(values));
+					break;
+				}
+				case TexCoordFormat::Unorm16x2:
+				{
+					const float u{ (vertex.uv.x - attributes.texCoordMin.x) / attributes.texCoordRange.x };
+					const float v{ (vertex.uv.y - attributes.texCoordMin.y) / attributes.texCoordRange.y };
+					const uint16_t values[2]{ uint16_t(std::round(std::clamp(u, 0.f, 1.f) * 65535.f)),
+						uint16_t(std::round(std::clamp(v, 0.f, 1.f) * 65535.f)) };
+					std::memcpy(pTexCoord, values, sizeof(values));
+					break;
+				}
+				}
+
+				PackDirection(vertex.normal, layout.normal, attributes.normals.data() + i * normalSize);
+				PackDirection(vertex.tangent, layout.tangent, attributes.tangents.data() + i * tangentSize);
+			}
+		}
+
+		Vector2 DecodeTexCoord(const PackedAttributes& attributes, size_t index)
+		{
+			const uint8_t* pSource{ attributes.texCoords.data() + index * GetTexCoordSize(attributes.layout.texCoord) };
+
+			switch (attributes.layout.texCoord)
+			{
+			case TexCoordFormat::Half2:
+			{
+				uint16_t values[2]{};
+				std::memcpy(values, pSource, sizeof(values));
+				return { HalfToFloat(values[0]), HalfToFloat(values[1]) };
+			}
+			case TexCoordFormat::Unorm16x2:
+			{
+				uint16_t values[2]{};
+				std::memcpy(values, pSource, sizeof(values));
+				return { attributes.texCoordMin.x + values[0] * (attributes.texCoordRange.x / 65535.f),
+					attributes.texCoordMin.y + values[1] * (attributes.texCoordRange.y / 65535.f) };
+			}
+			default:
+			{
+				float values[2]{};
+				std::memcpy(values, pSource, sizeof(values));
+				return { values[0], values[1] };
+			}
+			}
+		}
+
+		Vector3 DecodeNormal(const PackedAttributes& attributes, size_t index)
+		{
+			return UnpackDirection(attributes.normals, attributes.layout.normal, index);
+		}
+
+		Vector3 DecodeTangent(const PackedAttributes& attributes, size_t index)
+		{
+			return UnpackDirection(attributes.tangents, attributes.layout.tangent, index);
+		}
+	}
+}
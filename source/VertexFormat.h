@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Math.h"
+
+namespace dae
+{
+	struct Vertex;
+
+	//Positions always stay float3, the vertex kernels stream them straight from the PositionStream
+	enum class TexCoordFormat
+	{
+		Float2,
+		Half2,
+		Unorm16x2
+	};
+
+	enum class DirectionFormat
+	{
+		None,
+		Float3,
+		Octahedral16
+	};
+
+	//Picks how every vertex attribute is stored, decoding happens in the vertex stage
+	struct VertexLayout
+	{
+		TexCoordFormat texCoord{ TexCoordFormat::Float2 };
+		DirectionFormat normal{ DirectionFormat::Float3 };
+		DirectionFormat tangent{ DirectionFormat::Float3 };
+
+		static VertexLayout Full() { return {}; }
+
+		//float3 position, unorm16x2 uv and octahedral normal and tangent: 24 bytes per vertex instead of 72
+		static VertexLayout Compact() { return { TexCoordFormat::Unorm16x2, DirectionFormat::Octahedral16, DirectionFormat::Octahedral16 }; }
+
+		//Size of one vertex, position included
+		size_t GetVertexSize() const;
+	};
+
+	//Every attribute except the position, each one packed tightly in its own stream
+	struct PackedAttributes
+	{
+		VertexLayout layout{};
+		size_t nrVertices{};
+
+		//Unorm16 uvs are quantized over the range the mesh actually uses
+		Vector2 texCoordMin{};
+		Vector2 texCoordRange{ 1.f, 1.f };
+
+		std::vector<uint8_t> texCoords{};
+		std::vector<uint8_t> normals{};
+		std::vector<uint8_t> tangents{};
+	};
+
+	namespace VertexFormat
+	{
+		uint16_t FloatToHalf(float value);
+		float HalfToFloat(uint16_t value);
+
+		//Folds a unit vector onto an octahedron and unfolds it onto a square, two snorm16 values per direction
+		void EncodeOctahedral(const Vector3& direction, int16_t& x, int16_t& y);
+		Vector3 DecodeOctahedral(int16_t x, int16_t y);
+
+		void PackAttributes(const std::vector<Vertex>& vertices, const VertexLayout& layout, PackedAttributes& attributes);
+
+		//Single vertex lookups, the vertex stage decodes the uvs of the whole mesh at once in VertexKernels
+		Vector2 DecodeTexCoord(const PackedAttributes& attributes, size_t index);
+		Vector3 DecodeNormal(const PackedAttributes& attributes, size_t index);
+		Vector3 DecodeTangent(const PackedAttributes& attributes, size_t index);
+	}
+}
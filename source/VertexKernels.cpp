@@ -0,0 +1,325 @@
+#include "VertexKernels.h"
+
+#include <immintrin.h>
+
+#include "FrameArena.h"
+
+namespace dae
+{
+	namespace
+	{
+		//Transforms x/y/z streams by the rotation of the matrix, the translation is only added to points. In and out may be the same streams
+		void TransformStreams(const float m[4][4], bool isPoint, const float* pInX, const float* pInY, const float* pInZ,
+			float* pOutX, float* pOutY, float* pOutZ, size_t firstVertex, size_t lastVertex)
+		{
+			float translation[3]{};
+			if (isPoint)
+				for (int c{ 0 }; c < 3; ++c)
+					translation[c] = m[3][c];
+
+			__m128 matrix[4][3];
+			for (int r{ 0 }; r < 3; ++r)
+				for (int c{ 0 }; c < 3; ++c)
+					matrix[r][c] = _mm_set1_ps(m[r][c]);
+			for (int c{ 0 }; c < 3; ++c)
+				matrix[3][c] = _mm_set1_ps(translation[c]);
+
+			size_t i{ firstVertex };
+			for (; i + 4 <= lastVertex; i += 4)
+			{
+				const __m128 x{ _mm_loadu_ps(pInX + i) };
+				const __m128 y{ _mm_loadu_ps(pInY + i) };
+				const __m128 z{ _mm_loadu_ps(pInZ + i) };
+
+				__m128 out[3];
+				for (int c{ 0 }; c < 3; ++c)
+				{
+					out[c] = _mm_add_ps(_mm_mul_ps(x, matrix[0][c]), _mm_mul_ps(y, matrix[1][c]));
+					out[c] = _mm_add_ps(out[c], _mm_mul_ps(z, matrix[2][c]));
+					out[c] = _mm_add_ps(out[c], matrix[3][c]);
+				}
+
+				_mm_storeu_ps(pOutX + i, out[0]);
+				_mm_storeu_ps(pOutY + i, out[1]);
+				_mm_storeu_ps(pOutZ + i, out[2]);
+			}
+
+			for (; i < lastVertex; ++i)
+			{
+				float out[3];
+				for (int c{ 0 }; c < 3; ++c)
+					out[c] = pInX[i] * m[0][c] + pInY[i] * m[1][c] + pInZ[i] * m[2][c] + translation[c];
+
+				pOutX[i] = out[0];
+				pOutY[i] = out[1];
+				pOutZ[i] = out[2];
+			}
+		}
+	}
+
+	namespace VertexKernels
+	{
+		void BuildPositionStream(const std::vector<Vertex>& vertices, PositionStream& positions)
+		{
+			const size_t nrVertices{ vertices.size() };
+			positions.x.resize(nrVertices);
+			positions.y.resize(nrVertices);
+			positions.z.resize(nrVertices);
+
+			for (size_t i{ 0 }; i < nrVertices; ++i)
+			{
+				positions.x[i] = vertices[i].position.x;
+				positions.y[i] = vertices[i].position.y;
+				positions.z[i] = vertices[i].position.z;
+			}
+		}
+
+		void AllocateTransformedPositions(size_t nrVertices, FrameArena& arena, TransformedPositions& positionsOut)
+		{
+			positionsOut.x = arena.Allocate<float>(nrVertices);
+			positionsOut.y = arena.Allocate<float>(nrVertices);
+			positionsOut.z = arena.Allocate<float>(nrVertices);
+			positionsOut.invW = arena.Allocate<float>(nrVertices);
+			positionsOut.isOutsideFrustum = arena.Allocate<uint8_t>(nrVertices);
+			positionsOut.u = arena.Allocate<float>(nrVertices);
+			positionsOut.v = arena.Allocate<float>(nrVertices);
+		}
+
+		void TransformPositions(const Matrix& worldViewProjection, int viewportWidth, int viewportHeight,
+			const PositionStream& positions, size_t firstVertex, size_t nrVertices, TransformedPositions& positionsOut)
+		{
+			const float* pInX{ positions.x.data() + firstVertex };
+			const float* pInY{ positions.y.data() + firstVertex };
+			const float* pInZ{ positions.z.data() + firstVertex };
+			float* pOutX{ positionsOut.x + firstVertex };
+			float* pOutY{ positionsOut.y + firstVertex };
+			float* pOutZ{ positionsOut.z + firstVertex };
+			float* pOutInvW{ positionsOut.invW + firstVertex };
+			uint8_t* pOutOutside{ positionsOut.isOutsideFrustum + firstVertex };
+
+			//Every matrix element gets its own register, rows are the x/y/z axis and the translation
+			float m[4][4];
+			for (int r{ 0 }; r < 4; ++r)
+				for (int c{ 0 }; c < 4; ++c)
+					m[r][c] = worldViewProjection[r][c];
+
+			const float width{ float(viewportWidth) };
+			const float height{ float(viewportHeight) };
+
+			size_t i{ 0 };
+
+#ifdef __AVX__
+			__m256 matrix[4][4];
+			for (int r{ 0 }; r < 4; ++r)
+				for (int c{ 0 }; c < 4; ++c)
+					matrix[r][c] = _mm256_set1_ps(m[r][c]);
+
+			const __m256 one{ _mm256_set1_ps(1.f) };
+			const __m256 minusOne{ _mm256_set1_ps(-1.f) };
+			const __m256 half{ _mm256_set1_ps(0.5f) };
+			const __m256 viewportWidthScale{ _mm256_set1_ps(width) };
+			const __m256 viewportHeightScale{ _mm256_set1_ps(height) };
+
+			for (; i + 8 <= nrVertices; i += 8)
+			{
+				const __m256 x{ _mm256_loadu_ps(pInX + i) };
+				const __m256 y{ _mm256_loadu_ps(pInY + i) };
+				const __m256 z{ _mm256_loadu_ps(pInZ + i) };
+
+				__m256 out[4];
+				for (int c{ 0 }; c < 4; ++c)
+				{
+					out[c] = _mm256_add_ps(_mm256_mul_ps(x, matrix[0][c]), _mm256_mul_ps(y, matrix[1][c]));
+					out[c] = _mm256_add_ps(out[c], _mm256_mul_ps(z, matrix[2][c]));
+					out[c] = _mm256_add_ps(out[c], matrix[3][c]);
+				}
+
+				const __m256 ndcX{ _mm256_div_ps(out[0], out[3]) };
+				const __m256 ndcY{ _mm256_div_ps(out[1], out[3]) };
+
+				const __m256 outside{ _mm256_or_ps(
+					_mm256_or_ps(_mm256_cmp_ps(ndcX, minusOne, _CMP_LT_OQ), _mm256_cmp_ps(ndcX, one, _CMP_GT_OQ)),
+					_mm256_or_ps(_mm256_cmp_ps(ndcY, minusOne, _CMP_LT_OQ), _mm256_cmp_ps(ndcY, one, _CMP_GT_OQ))) };
+				const int outsideMask{ _mm256_movemask_ps(outside) };
+
+				//Viewport: [-1, 1] to [0, width] with x going right and [-1, 1] to [0, height] with y going down
+				_mm256_storeu_ps(pOutX + i, _mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(ndcX, one), half), viewportWidthScale));
+				_mm256_storeu_ps(pOutY + i, _mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(one, ndcY), half), viewportHeightScale));
+				_mm256_storeu_ps(pOutZ + i, _mm256_div_ps(out[2], out[3]));
+				_mm256_storeu_ps(pOutInvW + i, _mm256_div_ps(one, out[3]));
+
+				for (int lane{ 0 }; lane < 8; ++lane)
+					pOutOutside[i + lane] = uint8_t((outsideMask >> lane) & 1);
+			}
+#else
+			__m128 matrix[4][4];
+			for (int r{ 0 }; r < 4; ++r)
+				for (int c{ 0 }; c < 4; ++c)
+					matrix[r][c] = _mm_set1_ps(m[r][c]);
+
+			const __m128 one{ _mm_set1_ps(1.f) };
+			const __m128 minusOne{ _mm_set1_ps(-1.f) };
+			const __m128 half{ _mm_set1_ps(0.5f) };
+			const __m128 viewportWidthScale{ _mm_set1_ps(width) };
+			const __m128 viewportHeightScale{ _mm_set1_ps(height) };
+
+			for (; i + 4 <= nrVertices; i += 4)
+			{
+				const __m128 x{ _mm_loadu_ps(pInX + i) };
+				const __m128 y{ _mm_loadu_ps(pInY + i) };
+				const __m128 z{ _mm_loadu_ps(pInZ + i) };
+
+				__m128 out[4];
+				for (int c{ 0 }; c < 4; ++c)
+				{
+					out[c] = _mm_add_ps(_mm_mul_ps(x, matrix[0][c]), _mm_mul_ps(y, matrix[1][c]));
+					out[c] = _mm_add_ps(out[c], _mm_mul_ps(z, matrix[2][c]));
+					out[c] = _mm_add_ps(out[c], matrix[3][c]);
+				}
+
+				const __m128 ndcX{ _mm_div_ps(out[0], out[3]) };
+				const __m128 ndcY{ _mm_div_ps(out[1], out[3]) };
+
+				const __m128 outside{ _mm_or_ps(
+					_mm_or_ps(_mm_cmplt_ps(ndcX, minusOne), _mm_cmpgt_ps(ndcX, one)),
+					_mm_or_ps(_mm_cmplt_ps(ndcY, minusOne), _mm_cmpgt_ps(ndcY, one))) };
+				const int outsideMask{ _mm_movemask_ps(outside) };
+
+				//Viewport: [-1, 1] to [0, width] with x going right and [-1, 1] to [0, height] with y going down
+				_mm_storeu_ps(pOutX + i, _mm_mul_ps(_mm_mul_ps(_mm_add_ps(ndcX, one), half), viewportWidthScale));
+				_mm_storeu_ps(pOutY + i, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(one, ndcY), half), viewportHeightScale));
+				_mm_storeu_ps(pOutZ + i, _mm_div_ps(out[2], out[3]));
+				_mm_storeu_ps(pOutInvW + i, _mm_div_ps(one, out[3]));
+
+				for (int lane{ 0 }; lane < 4; ++lane)
+					pOutOutside[i + lane] = uint8_t((outsideMask >> lane) & 1);
+			}
+#endif
+
+			//Leftovers that don't fill a whole register
+			for (; i < nrVertices; ++i)
+			{
+				float out[4];
+				for (int c{ 0 }; c < 4; ++c)
+					out[c] = pInX[i] * m[0][c] + pInY[i] * m[1][c] + pInZ[i] * m[2][c] + m[3][c];
+
+				const float ndcX{ out[0] / out[3] };
+				const float ndcY{ out[1] / out[3] };
+
+				pOutX[i] = (ndcX + 1.f) * 0.5f * width;
+				pOutY[i] = (1.f - ndcY) * 0.5f * height;
+				pOutZ[i] = out[2] / out[3];
+				pOutInvW[i] = 1.f / out[3];
+				pOutOutside[i] = ndcX < -1.f || ndcX > 1.f || ndcY < -1.f || ndcY > 1.f;
+			}
+		}
+
+		void DecodeTexCoords(const PackedAttributes& attributes, size_t firstVertex, size_t nrVertices, TransformedPositions& positionsOut)
+		{
+			const size_t lastVertex{ firstVertex + nrVertices };
+			const float* pInvW{ positionsOut.invW };
+			float* pOutU{ positionsOut.u };
+			float* pOutV{ positionsOut.v };
+
+			size_t i{ firstVertex };
+
+			switch (attributes.layout.texCoord)
+			{
+			case TexCoordFormat::Float2:
+			{
+				const float* pTexCoords{ reinterpret_cast<const float*>(attributes.texCoords.data()) };
+
+				//Two vertices per load, the u and v lanes get split with a shuffle
+				for (; i + 4 <= lastVertex; i += 4)
+				{
+					const __m128 first{ _mm_loadu_ps(pTexCoords + 2 * i) };
+					const __m128 second{ _mm_loadu_ps(pTexCoords + 2 * i + 4) };
+					const __m128 invW{ _mm_loadu_ps(pInvW + i) };
+
+					_mm_storeu_ps(pOutU + i, _mm_mul_ps(_mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0)), invW));
+					_mm_storeu_ps(pOutV + i, _mm_mul_ps(_mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1)), invW));
+				}
+				break;
+			}
+			case TexCoordFormat::Unorm16x2:
+			{
+				const uint16_t* pTexCoords{ reinterpret_cast<const uint16_t*>(attributes.texCoords.data()) };
+
+				const __m128 scale{ _mm_setr_ps(attributes.texCoordRange.x / 65535.f, attributes.texCoordRange.y / 65535.f,
+					attributes.texCoordRange.x / 65535.f, attributes.texCoordRange.y / 65535.f) };
+				const __m128 offset{ _mm_setr_ps(attributes.texCoordMin.x, attributes.texCoordMin.y,
+					attributes.texCoordMin.x, attributes.texCoordMin.y) };
+				const __m128i zero{ _mm_setzero_si128() };
+
+				//Four vertices in one 128 bit load, widened to 32 bit and converted to float
+				for (; i + 4 <= lastVertex; i += 4)
+				{
+					const __m128i packed{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(pTexCoords + 2 * i)) };
+					const __m128 first{ _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(packed, zero)), scale), offset) };
+					const __m128 second{ _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(packed, zero)), scale), offset) };
+					const __m128 invW{ _mm_loadu_ps(pInvW + i) };
+
+					_mm_storeu_ps(pOutU + i, _mm_mul_ps(_mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0)), invW));
+					_mm_storeu_ps(pOutV + i, _mm_mul_ps(_mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1)), invW));
+				}
+				break;
+			}
+			default:
+				//Half floats go through the scalar conversion below
+				break;
+			}
+
+			for (; i < lastVertex; ++i)
+			{
+				const Vector2 texCoord{ VertexFormat::DecodeTexCoord(attributes, i) };
+				pOutU[i] = texCoord.x * pInvW[i];
+				pOutV[i] = texCoord.y * pInvW[i];
+			}
+		}
+
+		void AllocateLitAttributes(size_t nrVertices, FrameArena& arena, TransformedPositions& positionsOut)
+		{
+			positionsOut.worldX = arena.Allocate<float>(nrVertices);
+			positionsOut.worldY = arena.Allocate<float>(nrVertices);
+			positionsOut.worldZ = arena.Allocate<float>(nrVertices);
+			positionsOut.normalX = arena.Allocate<float>(nrVertices);
+			positionsOut.normalY = arena.Allocate<float>(nrVertices);
+			positionsOut.normalZ = arena.Allocate<float>(nrVertices);
+			positionsOut.tangentX = arena.Allocate<float>(nrVertices);
+			positionsOut.tangentY = arena.Allocate<float>(nrVertices);
+			positionsOut.tangentZ = arena.Allocate<float>(nrVertices);
+		}
+
+		void TransformLitAttributes(const Matrix& world, const PositionStream& positions, const PackedAttributes& attributes,
+			size_t firstVertex, size_t nrVertices, TransformedPositions& positionsOut)
+		{
+			const size_t lastVertex{ firstVertex + nrVertices };
+
+			float m[4][4];
+			for (int r{ 0 }; r < 4; ++r)
+				for (int c{ 0 }; c < 4; ++c)
+					m[r][c] = world[r][c];
+
+			//The directions are decoded straight into the output and transformed where they are
+			for (size_t i{ firstVertex }; i < lastVertex; ++i)
+			{
+				const Vector3 normal{ VertexFormat::DecodeNormal(attributes, i) };
+				positionsOut.normalX[i] = normal.x;
+				positionsOut.normalY[i] = normal.y;
+				positionsOut.normalZ[i] = normal.z;
+
+				const Vector3 tangent{ VertexFormat::DecodeTangent(attributes, i) };
+				positionsOut.tangentX[i] = tangent.x;
+				positionsOut.tangentY[i] = tangent.y;
+				positionsOut.tangentZ[i] = tangent.z;
+			}
+
+			TransformStreams(m, true, positions.x.data(), positions.y.data(), positions.z.data(),
+				positionsOut.worldX, positionsOut.worldY, positionsOut.worldZ, firstVertex, lastVertex);
+			TransformStreams(m, false, positionsOut.normalX, positionsOut.normalY, positionsOut.normalZ,
+				positionsOut.normalX, positionsOut.normalY, positionsOut.normalZ, firstVertex, lastVertex);
+			TransformStreams(m, false, positionsOut.tangentX, positionsOut.tangentY, positionsOut.tangentZ,
+				positionsOut.tangentX, positionsOut.tangentY, positionsOut.tangentZ, firstVertex, lastVertex);
+		}
+	}
+}
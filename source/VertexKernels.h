@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	class FrameArena;
+
+	namespace VertexKernels
+	{
+		//Splits the positions of the vertices into the x/y/z streams the kernels work on
+		void BuildPositionStream(const std::vector<Vertex>& vertices, PositionStream& positions);
+
+		//Room for every output stream of a mesh with this many vertices, nothing is initialized.
+		//The kernels only write the ranges they're given, the rest stays garbage
+		void AllocateTransformedPositions(size_t nrVertices, FrameArena& arena, TransformedPositions& positionsOut);
+
+		//Transforms a range of positions by the matrix, does the perspective divide and maps x and y to the viewport in one pass
+		//8 positions at a time when AVX is available, 4 with SSE otherwise
+		void TransformPositions(const Matrix& worldViewProjection, int viewportWidth, int viewportHeight,
+			const PositionStream& positions, size_t firstVertex, size_t nrVertices, TransformedPositions& positionsOut);
+
+		//Decodes the packed uvs of a range and multiplies them by the 1/w of TransformPositions, ready for perspective correct interpolation
+		void DecodeTexCoords(const PackedAttributes& attributes, size_t firstVertex, size_t nrVertices, TransformedPositions& positionsOut);
+
+		//Room for the world space streams of the lit mode, like AllocateTransformedPositions nothing is initialized
+		void AllocateLitAttributes(size_t nrVertices, FrameArena& arena, TransformedPositions& positionsOut);
+
+		//Positions, normals and tangents of a range in world space. The directions are decoded one by one and then transformed 4 at a time,
+		//they aren't normalized again since the rasterizer has to do that per pixel anyway
+		void TransformLitAttributes(const Matrix& world, const PositionStream& positions, const PackedAttributes& attributes,
+			size_t firstVertex, size_t nrVertices, TransformedPositions& positionsOut);
+	}
+}
@@ -5,14 +5,425 @@
 #undef main
 
 //Standard includes
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <string>
 
 //Project includes
+#include "AllocationCounter.h"
+#include "Benchmark.h"
+#include "BinningBenchmark.h"
+#include "CameraPath.h"
+#include "JobSystem.h"
+#include "Profiler.h"
 #include "Timer.h"
 #include "Renderer.h"
+#include "RenderTarget.h"
+#include "Scene.h"
 
 using namespace dae;
 
+enum class RunMode
+{
+	interactive,
+	batch,
+	benchmark,
+	binningBenchmark
+};
+
+struct BatchSettings
+{
+	RunMode runMode{ RunMode::interactive };
+	int nrFrames{ 60 };
+	int nrWarmupFrames{ 10 };
+	int width{ 640 };
+	int height{ 480 };
+	std::string cameraPathFile{};
+	std::string outputDirectory{};
+	std::string jsonFile{};
+	std::string traceFile{};
+	VertexLayout vertexLayout{};
+	DefaultModel model{ DefaultModel::tuktuk };
+	int fleetSize{ 1 };
+	bool useOcclusionCulling{ true };
+	float lodErrorThreshold{ 1.f };
+	//0 picks one worker per extra hardware thread
+	int nrWorkers{ 0 };
+	bool pinWorkers{ false };
+	bool useFramePipelining{ true };
+	//0 keeps the render resolution fixed at the maximum scale
+	float frameBudgetMilliseconds{ 0.f };
+	float minResolutionScale{ 0.5f };
+	float maxResolutionScale{ 1.f };
+	bool useMultisampling{ false };
+	bool useEdgeAntialiasing{ false };
+	bool useLitShading{ false };
+	//Only used by the binning benchmark
+	int nrBinningTriangles{ 50000 };
+};
+
+//The value stays what it was when the text isn't a number, the same way unknown vertex layouts fall back to the default
+template<typename T>
+void ParseNumber(const std::string& argument, const char* pText, T& value)
+{
+	const char* pEnd{ pText + std::strlen(pText) };
+	T parsed{};
+	const auto [pLast, error] { std::from_chars(pText, pEnd, parsed) };
+	if (error != std::errc{} || pLast != pEnd)
+	{
+		std::cout << "Unknown value " << pText << " for " << argument << ", using " << value << std::endl;
+		return;
+	}
+	value = parsed;
+}
+
+//Figures out if we run interactively, render a batch (--batch), benchmark (--benchmark) or only benchmark binning (--benchmark-binning)
+void ParseBatchSettings(int argc, char* args[], BatchSettings& settings)
+{
+	for (int i{ 1 }; i < argc; ++i)
+	{
+		const std::string argument{ args[i] };
+		const bool hasValue{ i + 1 < argc };
+
+		if (argument == "--batch" || argument == "--benchmark" || argument == "--benchmark-binning")
+		{
+			if (argument == "--batch")
+				settings.runMode = RunMode::batch;
+			else
+				settings.runMode = argument == "--benchmark" ? RunMode::benchmark : RunMode::binningBenchmark;
+			if (hasValue && std::isdigit(static_cast<unsigned char>(args[i + 1][0])))
+				ParseNumber(argument, args[++i], settings.nrFrames);
+		}
+		else if (argument == "--warmup" && hasValue)
+			ParseNumber(argument, args[++i], settings.nrWarmupFrames);
+		else if (argument == "--json" && hasValue)
+			settings.jsonFile = args[++i];
+		else if (argument == "--trace" && hasValue)
+			settings.traceFile = args[++i];
+		else if ((argument == "--width" || argument == "--height") && hasValue)
+		{
+			//The render resolution never goes below 2 pixels when it scales down, the output can't be smaller than that either
+			int& size{ argument == "--width" ? settings.width : settings.height };
+			const int previousSize{ size };
+			ParseNumber(argument, args[++i], size);
+			if (size < 2)
+			{
+				std::cout << argument << " has to be at least 2, using " << previousSize << std::endl;
+				size = previousSize;
+			}
+		}
+		else if (argument == "--path" && hasValue)
+			settings.cameraPathFile = args[++i];
+		else if (argument == "--output" && hasValue)
+			settings.outputDirectory = args[++i];
+		else if (argument == "--fleet" && hasValue)
+		{
+			ParseNumber(argument, args[++i], settings.fleetSize);
+			settings.fleetSize = std::max(settings.fleetSize, 1);
+		}
+		else if (argument == "--no-occlusion")
+			settings.useOcclusionCulling = false;
+		else if (argument == "--lod-error" && hasValue)
+			ParseNumber(argument, args[++i], settings.lodErrorThreshold);
+		else if (argument == "--workers" && hasValue)
+			ParseNumber(argument, args[++i], settings.nrWorkers);
+		else if (argument == "--pin-workers")
+			settings.pinWorkers = true;
+		else if (argument == "--no-pipeline")
+			settings.useFramePipelining = false;
+		else if (argument == "--frame-budget" && hasValue)
+			ParseNumber(argument, args[++i], settings.frameBudgetMilliseconds);
+		else if (argument == "--min-render-scale" && hasValue)
+			ParseNumber(argument, args[++i], settings.minResolutionScale);
+		else if (argument == "--render-scale" && hasValue)
+			ParseNumber(argument, args[++i], settings.maxResolutionScale);
+		else if (argument == "--msaa")
+			settings.useMultisampling = true;
+		else if (argument == "--fxaa")
+			settings.useEdgeAntialiasing = true;
+		else if (argument == "--lit")
+			settings.useLitShading = true;
+		else if (argument == "--triangles" && hasValue)
+		{
+			ParseNumber(argument, args[++i], settings.nrBinningTriangles);
+			settings.nrBinningTriangles = std::max(settings.nrBinningTriangles, 1);
+		}
+		else if (argument == "--vertex-layout" && hasValue)
+		{
+			const std::string layout{ args[++i] };
+			if (layout == "compact")
+				settings.vertexLayout = VertexLayout::Compact();
+			else if (layout != "full")
+				std::cout << "Unknown vertex layout " << layout << ", using full" << std::endl;
+		}
+		else if (argument == "--model" && hasValue)
+		{
+			const std::string model{ args[++i] };
+			if (model == "vehicle")
+				settings.model = DefaultModel::vehicle;
+			else if (model != "tuktuk")
+				std::cout << "Unknown model " << model << ", using tuktuk" << std::endl;
+		}
+	}
+}
+
+//Fills the scene with copies of the first instance on a grid, the first one stays in the middle of the front row.
+//Every vehicle is its own occluder, the rows in front hide the odd one further back that lines up with them
+void PopulateFleet(Scene& scene, int fleetSize)
+{
+	if (fleetSize <= 1 || scene.GetInstances().empty()) return;
+
+	const MeshInstance vehicle{ scene.GetInstances()[0] };
+	const BoundingBox& bounds{ scene.GetMeshes()[vehicle.meshIndex].boundingBox };
+	const float spacingX{ (bounds.max.x - bounds.min.x) * 1.5f };
+	const float spacingZ{ (bounds.max.z - bounds.min.z) * 1.5f };
+
+	const int nrColumns{ int(std::ceil(std::sqrt(float(fleetSize)))) };
+	const int middleColumn{ nrColumns / 2 };
+
+	for (int i{ 0 }; i < fleetSize; ++i)
+	{
+		//Column order starts in the middle so instance 0 keeps its place
+		const int column{ (middleColumn + i % nrColumns) % nrColumns };
+		const int row{ i / nrColumns };
+		const Matrix worldMatrix{ Matrix::CreateTranslation((column - middleColumn) * spacingX, 0.f, row * spacingZ) };
+
+		int instanceIndex{ 0 };
+		if (i == 0)
+			scene.SetWorldMatrix(0, worldMatrix);
+		else
+		{
+			instanceIndex = scene.AddInstance(vehicle.meshIndex, vehicle.textureIndex, worldMatrix);
+			scene.SetMaterialMaps(instanceIndex, vehicle.normalMapIndex, vehicle.specularMapIndex, vehicle.glossMapIndex);
+		}
+
+		scene.SetOccluder(instanceIndex, vehicle.meshIndex);
+	}
+}
+
+//Everything the command line sets on the renderer, the same for every mode
+void ConfigureRenderer(Renderer& renderer, const BatchSettings& settings)
+{
+	PopulateFleet(renderer.GetScene(), settings.fleetSize);
+	renderer.SetOcclusionCulling(settings.useOcclusionCulling);
+	renderer.SetLodErrorThreshold(settings.lodErrorThreshold);
+	renderer.SetFramePipelining(settings.useFramePipelining);
+	renderer.SetResolutionScaleRange(settings.minResolutionScale, settings.maxResolutionScale);
+	renderer.SetFrameTimeBudget(settings.frameBudgetMilliseconds);
+	renderer.SetMultisampling(settings.useMultisampling);
+	renderer.SetEdgeAntialiasing(settings.useEdgeAntialiasing);
+	renderer.SetLitShading(settings.useLitShading);
+}
+
+bool LoadCameraPath(const BatchSettings& settings, CameraPath& cameraPath)
+{
+	if (!settings.cameraPathFile.empty() && !cameraPath.LoadFromFile(settings.cameraPathFile))
+	{
+		std::cout << "Could not load camera path " << settings.cameraPathFile << std::endl;
+		return false;
+	}
+
+	//Without a path we orbit around the model at the default camera distance
+	if (cameraPath.IsEmpty())
+		cameraPath = CameraPath::CreateOrbit({ 0.f, 5.f, 0.f }, 30.f, 0.f, 1.f);
+
+	return true;
+}
+
+void BeginTrace(const BatchSettings& settings)
+{
+	if (settings.traceFile.empty()) return;
+
+#ifndef ENABLE_PROFILING
+	std::cout << "Profiling is compiled out, define ENABLE_PROFILING to get a trace" << std::endl;
+#endif
+	Profiler::GetInstance().SetThreadName("Main");
+	Profiler::GetInstance().BeginCapture();
+}
+
+void EndTrace(const BatchSettings& settings)
+{
+	if (settings.traceFile.empty()) return;
+
+	Profiler::GetInstance().EndCapture();
+	if (!Profiler::GetInstance().WriteChromeTrace(settings.traceFile))
+		std::cout << "Something went wrong. Trace not saved!" << std::endl;
+}
+
+//Renders the frames of a camera path without ever opening a window
+int RunBatch(const BatchSettings& settings)
+{
+	SDL_Init(0);
+
+	CameraPath cameraPath{};
+	if (!LoadCameraPath(settings, cameraPath))
+	{
+		SDL_Quit();
+		return 1;
+	}
+
+	const auto pRenderTarget = new MemoryRenderTarget(settings.width, settings.height);
+	if (!pRenderTarget->IsValid())
+	{
+		std::cout << "Could not create a " << settings.width << "x" << settings.height << " render target: " << SDL_GetError() << std::endl;
+		delete pRenderTarget;
+		SDL_Quit();
+		return 1;
+	}
+
+	JobSystem jobSystem{ settings.nrWorkers, settings.pinWorkers };
+	const auto pRenderer = new Renderer(pRenderTarget, &jobSystem, settings.vertexLayout, settings.model);
+	ConfigureRenderer(*pRenderer, settings);
+
+	auto saveFrame = [&settings, pRenderTarget](int frame)
+	{
+		if (settings.outputDirectory.empty()) return;
+
+		char fileName[32]{};
+		std::snprintf(fileName, sizeof(fileName), "frame_%04d.bmp", frame);
+
+		if (!pRenderTarget->SaveToFile(settings.outputDirectory + "/" + fileName))
+			std::cout << "Something went wrong. Frame " << frame << " not saved!" << std::endl;
+	};
+
+	BeginTrace(settings);
+
+	for (int frame{ 0 }; frame < settings.nrFrames; ++frame)
+	{
+		const float time{ cameraPath.GetDuration() * frame / std::max(settings.nrFrames - 1, 1) };
+
+		Vector3 origin{}, forward{};
+		cameraPath.Sample(time, origin, forward);
+		pRenderer->SetCameraTransform(origin, forward);
+
+		pRenderer->Render();
+
+		//With pipelining the frame that just got presented is the one before
+		const int presentedFrame{ settings.useFramePipelining ? frame - 1 : frame };
+		if (presentedFrame >= 0)
+			saveFrame(presentedFrame);
+	}
+
+	if (settings.useFramePipelining && settings.nrFrames > 0)
+	{
+		pRenderer->Flush();
+		saveFrame(settings.nrFrames - 1);
+	}
+
+	EndTrace(settings);
+
+	std::cout << "Rendered " << settings.nrFrames << " frames" << std::endl;
+
+	delete pRenderer;
+	delete pRenderTarget;
+
+	SDL_Quit();
+	return 0;
+}
+
+//Headless as well, prints the results as JSON or writes them to the --json file
+int RunBenchmark(const BatchSettings& settings)
+{
+	SDL_Init(0);
+
+	CameraPath cameraPath{};
+	if (!LoadCameraPath(settings, cameraPath))
+	{
+		SDL_Quit();
+		return 1;
+	}
+
+	const auto pRenderTarget = new MemoryRenderTarget(settings.width, settings.height);
+	if (!pRenderTarget->IsValid())
+	{
+		std::cout << "Could not create a " << settings.width << "x" << settings.height << " render target: " << SDL_GetError() << std::endl;
+		delete pRenderTarget;
+		SDL_Quit();
+		return 1;
+	}
+
+	JobSystem jobSystem{ settings.nrWorkers, settings.pinWorkers };
+	const auto pRenderer = new Renderer(pRenderTarget, &jobSystem, settings.vertexLayout, settings.model);
+	ConfigureRenderer(*pRenderer, settings);
+
+	Benchmark benchmark{ pRenderer, cameraPath };
+	BeginTrace(settings);
+	benchmark.Run(settings.nrFrames, settings.nrWarmupFrames);
+	EndTrace(settings);
+
+	int result{ 0 };
+	if (settings.jsonFile.empty())
+	{
+		benchmark.WriteJson(std::cout);
+	}
+	else
+	{
+		std::ofstream jsonFile{ settings.jsonFile };
+		if (jsonFile)
+			benchmark.WriteJson(jsonFile);
+		else
+		{
+			std::cout << "Could not write benchmark results to " << settings.jsonFile << std::endl;
+			result = 1;
+		}
+	}
+
+	//The arenas should have settled during warmup, a trace records into vectors that grow so those runs can't tell
+	if (!AllocationCounter::IsCounting())
+		std::cout << "Heap allocations aren't counted, define ENABLE_ALLOCATION_COUNTING to check there are none" << std::endl;
+	else if (benchmark.GetNrHeapAllocations() > 0 && settings.traceFile.empty())
+	{
+		std::cout << "The measured frames made " << benchmark.GetNrHeapAllocations() << " heap allocations, there should be none after warmup" << std::endl;
+		result = 1;
+	}
+
+	delete pRenderer;
+	delete pRenderTarget;
+
+	SDL_Quit();
+	return result;
+}
+
+//Only the binning step of the renderer on made up triangles, see BinningBenchmark
+int RunBinningBenchmark(const BatchSettings& settings)
+{
+	JobSystem jobSystem{ settings.nrWorkers, settings.pinWorkers };
+	BinningBenchmark benchmark{ &jobSystem, settings.width, settings.height, settings.nrBinningTriangles };
+	benchmark.Run(settings.nrFrames, settings.nrWarmupFrames);
+
+	int result{ 0 };
+	if (settings.jsonFile.empty())
+	{
+		benchmark.WriteJson(std::cout);
+	}
+	else
+	{
+		std::ofstream jsonFile{ settings.jsonFile };
+		if (jsonFile)
+			benchmark.WriteJson(jsonFile);
+		else
+		{
+			std::cout << "Could not write benchmark results to " << settings.jsonFile << std::endl;
+			result = 1;
+		}
+	}
+
+	//Fast binning is worth nothing when the tiles draw their triangles in the wrong order
+	if (!benchmark.IsInOrder())
+	{
+		std::cout << "Binning lost triangles or put them out of submission order" << std::endl;
+		result = 1;
+	}
+
+	return result;
+}
+
 void ShutDown(SDL_Window* pWindow)
 {
 	SDL_DestroyWindow(pWindow);
@@ -21,15 +432,22 @@ void ShutDown(SDL_Window* pWindow)
 
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
+	BatchSettings batchSettings{};
+	ParseBatchSettings(argc, args, batchSettings);
+
+	if (batchSettings.runMode == RunMode::batch)
+		return RunBatch(batchSettings);
+	if (batchSettings.runMode == RunMode::benchmark)
+		return RunBenchmark(batchSettings);
+	if (batchSettings.runMode == RunMode::binningBenchmark)
+		return RunBinningBenchmark(batchSettings);
 
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
 
-	const uint32_t width = 640;
-	const uint32_t height = 480;
+	//The window has the output resolution, what gets rendered can be smaller and is scaled up to it
+	const uint32_t width = batchSettings.width;
+	const uint32_t height = batchSettings.height;
 
 	SDL_Window* pWindow = SDL_CreateWindow(
 		"Software Rasterizer",
@@ -42,13 +460,18 @@ int main(int argc, char* args[])
 
 	//Initialize "framework"
 	const auto pTimer = new Timer();
-	const auto pRenderer = new Renderer(pWindow);
+	const auto pRenderTarget = new WindowRenderTarget(pWindow);
+	JobSystem jobSystem{ batchSettings.nrWorkers, batchSettings.pinWorkers };
+	const auto pRenderer = new Renderer(pRenderTarget, &jobSystem, batchSettings.vertexLayout, batchSettings.model);
+	ConfigureRenderer(*pRenderer, batchSettings);
 
 	//Start loop
 	pTimer->Start();
 	float printTimer = 0.f;
 	bool isLooping = true;
 	bool takeScreenshot = false;
+	bool toggleTrace = false;
+	Profiler::GetInstance().SetThreadName("Main");
 	while (isLooping)
 	{
 		//--------- Get input events ---------
@@ -65,7 +488,31 @@ int main(int argc, char* args[])
 					takeScreenshot = true;
 				if (e.key.keysym.scancode == SDL_SCANCODE_F4)
 					pRenderer->ToggleRenderMode();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F5)
+					toggleTrace = true;
+				if (e.key.keysym.scancode == SDL_SCANCODE_F6)
+				{
+					pRenderer->SetMultisampling(!pRenderer->IsMultisampling());
+					std::cout << "MSAA " << (pRenderer->IsMultisampling() ? "on" : "off") << std::endl;
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F7)
+				{
+					pRenderer->ToggleEdgeAntialiasing();
+					std::cout << "FXAA " << (pRenderer->IsEdgeAntialiasing() ? "on" : "off") << std::endl;
+				}
 
+				break;
+			case SDL_MOUSEBUTTONUP:
+				//Left and right are used by the camera, the middle button picks
+				if (e.button.button == SDL_BUTTON_MIDDLE)
+				{
+					float distance{};
+					const int instanceIndex{ pRenderer->Pick(e.button.x, e.button.y, distance) };
+					if (instanceIndex >= 0)
+						std::cout << "Picked instance " << instanceIndex << " at distance " << distance << std::endl;
+					else
+						std::cout << "Nothing picked" << std::endl;
+				}
 				break;
 			}
 		}
@@ -76,6 +523,10 @@ int main(int argc, char* args[])
 		//--------- Render ---------
 		pRenderer->Render();
 
+		//Nothing changed, so there's nothing to do until some input arrives
+		if (pRenderer->WasFrameSkipped())
+			SDL_WaitEventTimeout(nullptr, 16);
+
 		//--------- Timer ---------
 		pTimer->Update();
 		printTimer += pTimer->GetElapsed();
@@ -94,11 +545,32 @@ int main(int argc, char* args[])
 				std::cout << "Something went wrong. Screenshot not saved!" << std::endl;
 			takeScreenshot = false;
 		}
+
+		//First press starts capturing a trace, the second one writes it out
+		if (toggleTrace)
+		{
+			Profiler& profiler = Profiler::GetInstance();
+			if (!profiler.IsCapturing())
+			{
+				profiler.BeginCapture();
+				std::cout << "Capturing trace..." << std::endl;
+			}
+			else
+			{
+				profiler.EndCapture();
+				if (profiler.WriteChromeTrace("Rasterizer_Trace.json"))
+					std::cout << "Trace saved!" << std::endl;
+				else
+					std::cout << "Something went wrong. Trace not saved!" << std::endl;
+			}
+			toggleTrace = false;
+		}
 	}
 	pTimer->Stop();
 
 	//Shutdown "framework"
 	delete pRenderer;
+	delete pRenderTarget;
 	delete pTimer;
 
 	ShutDown(pWindow);